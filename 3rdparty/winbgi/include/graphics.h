@@ -25,7 +25,30 @@
 // ---------------------------------------------------------------------------
 #ifndef WINBGI_H
 #define WINBGI_H
+#ifndef WINBGI_SOFTWARE
 #include <windows.h>        // Provides the mouse message types
+#else
+// The software backend does not use Windows at all.  These are the few
+// definitions the API needs from windows.h, with the same values.
+typedef void* HWND;
+#define WM_MOUSEFIRST       0x0200
+#define WM_MOUSEMOVE        0x0200
+#define WM_LBUTTONDOWN      0x0201
+#define WM_LBUTTONUP        0x0202
+#define WM_LBUTTONDBLCLK    0x0203
+#define WM_RBUTTONDOWN      0x0204
+#define WM_RBUTTONUP        0x0205
+#define WM_RBUTTONDBLCLK    0x0206
+#define WM_MBUTTONDOWN      0x0207
+#define WM_MBUTTONUP        0x0208
+#define WM_MBUTTONDBLCLK    0x0209
+#define WM_MOUSEWHEEL       0x020A
+#define WM_MOUSELAST        0x020A
+#define RGB(r,g,b)          ( (int)((unsigned char)(r) | ((unsigned char)(g) << 8) | ((unsigned char)(b) << 16)) )
+#define GetRValue(rgb)      ( (unsigned char)(rgb) )
+#define GetGValue(rgb)      ( (unsigned char)((rgb) >> 8) )
+#define GetBValue(rgb)      ( (unsigned char)((rgb) >> 16) )
+#endif
 #include <limits.h>         // Provides INT_MAX
 #include <sstream>          // Provides std::ostringstream
 // ---------------------------------------------------------------------------
@@ -186,6 +209,24 @@ struct palettetype
     unsigned char size;
     signed char colors[MAXCOLORS + 1];
 };
+
+
+#ifdef WINBGI_SOFTWARE
+// This structure describes an input event given to the software backend.
+// Kind is a mouse message (WM_MOUSEMOVE, WM_LBUTTONDOWN, ...), BGI_KEY with the
+// character in x, or BGI_CLOSE to close the window.
+#define BGI_KEY         1
+#define BGI_CLOSE       2
+struct bgievent
+{
+    int kind;                   // Type of the event
+    int x, y;                   // Mouse position, or the key in x
+};
+
+// An event source is asked for the events due at the given frame (the number
+// of swapbuffers calls so far) until it returns false.
+typedef bool (*bgieventsource)( unsigned frame, bgievent *event );
+#endif
 // ---------------------------------------------------------------------------
 
 
@@ -214,13 +255,17 @@ void linerel( int dx, int dy );
 void lineto( int x, int y );
 void pieslice( int x, int y, int stangle, int endangle, int radius );
 void putpixel( int x, int y, int color );
+void putpixels( int count, const int* xy, const int* colors );
 void rectangle( int left, int top, int right, int bottom );
 void sector( int x, int y, int stangle, int endangle, int xradius, int yradius );
+void thickline( int x1, int y1, int x2, int y2, int thickness );
 
 // Miscellaneous Functions
 int getdisplaycolor( int color );
 int converttorgb( int color );
+void beginframe( );
 void delay( int msec );
+void endframe( );
 void getarccoords( arccoordstype *arccoords );
 int getbkcolor( );
 int getcolor( );
@@ -232,6 +277,7 @@ int getmaxheight( );
 int getmaxwidth( );
 int getmaxx( );
 int getmaxy( );
+bool getrecordingbgi( );
 bool getrefreshingbgi( );
 int getwindowheight( );
 int getwindowwidth( );
@@ -248,6 +294,7 @@ void setcolor( int color );
 void setfillpattern( char *upattern, int color );
 void setfillstyle( int pattern, int color );
 void setlinestyle( int linestyle, unsigned upattern, int thickness );
+void setrecordingbgi(bool value);
 void setrefreshingbgi(bool value);
 void setviewport( int left, int top, int right, int bottom, int clip );
 void setwritemode( int mode );
@@ -293,6 +340,14 @@ void setactivepage( int page );
 void setvisualpage( int page );
 void swapbuffers( );
 
+#ifdef WINBGI_SOFTWARE
+// Software backend only (soft/winbgi.cxx)
+unsigned getframecount( );
+void postbgievent( int kind, int x, int y );
+void setbgieventsource( bgieventsource source );
+void setframedump( const char* pattern );
+#endif
+
 // Image Functions (drawing.cpp)
 unsigned imagesize( int left, int top, int right, int bottom );
 void getimage( int left, int top, int right, int bottom, void *bitmap );
@@ -0,0 +1,747 @@
+// File: drawing.cxx (software backend)
+//
+// The drawing functions of the software backend.  They rasterize into the
+// active page with the Raster functions (raster.cxx), using the settings
+// stored by misc.cxx, either at once or deferred to the tiles (tiles.cxx).
+// Coordinates are viewport relative and the drawing is clipped to the
+// viewport when it asks for clipping.
+//
+
+#define _USE_MATH_DEFINES   // Actually use the definitions in math.h
+#include <math.h>           // For mathematical functions
+#include <stdio.h>          // Provides FILE, fopen, fprintf, fwrite
+#include <stdlib.h>         // Provides abs
+#include <string.h>         // Provides memcpy
+#include <algorithm>        // Provides std::min, std::max
+#include <vector>           // Provides std::vector
+#include "winbgim.h"        // API routines
+#include "softtypes.h"      // Internal structure data
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+
+/*****************************************************************************
+*
+*   Helper functions
+*
+*****************************************************************************/
+RasterPage BGI__GetActivePage( )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    const viewporttype& vp = pWndData->viewportInfo;
+    RasterPage page;
+
+    page.pixels = pWndData->pages[pWndData->ActivePage].data( );
+    page.width = pWndData->width;
+    page.height = pWndData->height;
+    page.xorg = vp.left;
+    page.yorg = vp.top;
+    page.left = 0;
+    page.top = 0;
+    page.right = pWndData->width;
+    page.bottom = pWndData->height;
+    if ( vp.clip != 0 )
+    {
+        page.left = std::max( page.left, vp.left );
+        page.top = std::max( page.top, vp.top );
+        page.right = std::min( page.right, vp.right );
+        page.bottom = std::min( page.bottom, vp.bottom );
+    }
+    page.xorMode = pWndData->writeMode == XOR_PUT;
+    page.bounds = RasterEmptyRect( );
+    return page;
+}
+
+
+void BGI__AddDamage( const RasterPage& page )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    RasterDamageAdd( pWndData->damage[pWndData->ActivePage], page.bounds, pWndData->width, pWndData->height );
+}
+
+
+// The screen shows the previous page on a background of presentedColor,
+// damaged where presented says, and the visual page is its own clearColor
+// outside of its damage.  When both colors agree the two images can only
+// differ in the union of both damages, so only that is copied.  Only the
+// frame dumps look at the screen, so without them nothing is copied at all.
+//
+void BGI__Present( )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    int page = pWndData->VisualPage;
+    int width = pWndData->width;
+    RasterDamage damage;
+
+    if ( pWndData->dumpPattern.empty( ) )
+    {
+        // Make the next present with a dump copy everything
+        pWndData->presentedColor = -1;
+        return;
+    }
+
+    RasterDamageClear( damage );
+    if ( pWndData->clearColor[page] < 0 || pWndData->clearColor[page] != pWndData->presentedColor )
+    {
+        RasterRect all = { 0, 0, width, pWndData->height };
+        RasterDamageAdd( damage, all, width, pWndData->height );
+    }
+    else
+    {
+        RasterDamageAdd( damage, pWndData->presented, width, pWndData->height );
+        RasterDamageAdd( damage, pWndData->damage[page], width, pWndData->height );
+    }
+
+    for ( int i = 0; i < damage.count; i++ )
+    {
+        const RasterRect& r = damage.rects[i];
+        for ( int y = r.top; y < r.bottom; y++ )
+            memcpy( &pWndData->screen[y*width + r.left], &pWndData->pages[page][y*width + r.left],
+                    (r.right - r.left) * sizeof( unsigned int ) );
+    }
+    pWndData->presented = pWndData->damage[page];
+    pWndData->presentedColor = pWndData->clearColor[page];
+}
+
+
+// The fill settings of a call.  The pattern is copied, since a deferred call
+// is drawn after the user pattern may have changed.
+//
+struct Brush
+{
+    unsigned int color;
+    unsigned int bkColor;
+    bool solid;
+    unsigned char pattern[8];
+
+    RasterFill Fill( ) const
+    {
+        RasterFill fill = { color, bkColor, solid ? NULL : pattern };
+        return fill;
+    }
+};
+
+
+// The line settings of a call
+//
+struct Pen
+{
+    unsigned int color;
+    int thickness;
+    unsigned short pattern;
+};
+
+
+// Returns the current fill settings
+//
+static Brush CurrentBrush( WindowData* pWndData )
+{
+    Brush brush;
+    const unsigned char* pattern;
+
+    brush.color = BGI__ToPixel( pWndData->fillInfo.color );
+    brush.bkColor = BGI__ToPixel( pWndData->bgColor );
+    if ( pWndData->fillInfo.pattern == USER_FILL )
+        pattern = pWndData->uPattern;
+    else
+        pattern = RasterFillPattern( pWndData->fillInfo.pattern );
+    brush.solid = pattern == NULL;
+    if ( pattern != NULL )
+        memcpy( brush.pattern, pattern, sizeof( brush.pattern ) );
+    return brush;
+}
+
+
+// Returns the current drawing color and line style
+//
+static Pen CurrentPen( WindowData* pWndData )
+{
+    Pen pen;
+
+    pen.color = BGI__ToPixel( pWndData->drawColor );
+    pen.thickness = pWndData->lineInfo.thickness;
+    pen.pattern = RasterLinePattern( pWndData->lineInfo.linestyle, pWndData->lineInfo.upattern );
+    return pen;
+}
+
+
+// Draws a line with a pen
+//
+static void StyledLine( RasterPage& page, const Pen& pen, int x1, int y1, int x2, int y2 )
+{
+    RasterLine( page, x1, y1, x2, y2, pen.color, pen.thickness, pen.pattern );
+}
+
+
+// Returns the pixels from (left, top) to (right, bottom), both included,
+// grown by margin on every side
+//
+static RasterRect Around( int left, int top, int right, int bottom, int margin )
+{
+    RasterRect r = { std::min( left, right ) - margin, std::min( top, bottom ) - margin,
+                     std::max( left, right ) + margin + 1, std::max( top, bottom ) + margin + 1 };
+    return r;
+}
+
+
+// Returns the pixels around n (x, y) pairs, grown by margin on every side
+//
+static RasterRect AroundPoints( int n, const int* xy, int margin )
+{
+    RasterRect r = RasterEmptyRect( );
+
+    for ( int i = 0; i < n; i++ )
+    {
+        r.left = std::min( r.left, xy[i*2] - margin );
+        r.top = std::min( r.top, xy[i*2 + 1] - margin );
+        r.right = std::max( r.right, xy[i*2] + margin + 1 );
+        r.bottom = std::max( r.bottom, xy[i*2 + 1] + margin + 1 );
+    }
+    return r;
+}
+
+
+// This function converts coordinates of an arc, specified by a center, radii,
+// and start and end angle to actual coordinates of the window of the start
+// and end of the arc, and records them for getarccoords.
+//
+static void SetArcInfo( WindowData* pWndData, int x, int y, int xradius, int yradius,
+                        int stangle, int endangle )
+{
+    pWndData->arcInfo.x = x;
+    pWndData->arcInfo.y = y;
+    pWndData->arcInfo.xstart = x + int( xradius * cos( stangle  * M_PI / 180 ) );
+    pWndData->arcInfo.ystart = y - int( yradius * sin( stangle  * M_PI / 180 ) );
+    pWndData->arcInfo.xend   = x + int( xradius * cos( endangle * M_PI / 180 ) );
+    pWndData->arcInfo.yend   = y - int( yradius * sin( endangle * M_PI / 180 ) );
+}
+
+
+// Fills and outlines an elliptical pie slice
+//
+static void Pie( WindowData* pWndData, int x, int y, int stangle, int endangle, int xradius, int yradius )
+{
+    Brush brush = CurrentBrush( pWndData );
+    Pen pen = CurrentPen( pWndData );
+    std::vector<int> points;
+
+    while ( endangle <= stangle )
+        endangle += 360;
+    int steps = std::max( 8, (int)( (endangle - stangle) * M_PI / 180 * std::max( xradius, yradius ) / 2 ) );
+
+    points.push_back( x );
+    points.push_back( y );
+    for ( int i = 0; i <= steps; i++ )
+    {
+        double a = ( stangle + (endangle - stangle) * double( i ) / steps ) * M_PI / 180;
+        points.push_back( x + (int)lround( xradius * cos( a ) ) );
+        points.push_back( y - (int)lround( yradius * sin( a ) ) );
+    }
+
+    RasterRect bounds = Around( x - abs( xradius ), y - abs( yradius ), x + abs( xradius ), y + abs( yradius ),
+                                pen.thickness );
+    BGI__Draw( bounds, [=]( RasterPage& page )
+    {
+        RasterPolygon( page, (int)points.size( ) / 2, points.data( ), brush.Fill( ) );
+        RasterArc( page, x, y, stangle, endangle, xradius, yradius, pen.color, pen.thickness );
+        StyledLine( page, pen, x, y, points[2], points[3] );
+        StyledLine( page, pen, x, y, points[points.size( ) - 2], points[points.size( ) - 1] );
+    } );
+    SetArcInfo( pWndData, x, y, xradius, yradius, stangle, endangle );
+}
+
+
+bool BGI__WritePPM( const char* filename, const unsigned int* pixels, int left, int top, int right, int bottom )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    FILE* file;
+
+    left = std::max( left, 0 );
+    top = std::max( top, 0 );
+    right = std::min( right, pWndData->width - 1 );
+    bottom = std::min( bottom, pWndData->height - 1 );
+    if ( right < left || bottom < top || (file = fopen( filename, "wb" )) == NULL )
+        return false;
+
+    int width = right - left + 1;
+    std::vector<unsigned char> row( width * 3 );
+    fprintf( file, "P6\n%d %d\n255\n", width, bottom - top + 1 );
+    for ( int y = top; y <= bottom; y++ )
+    {
+        const unsigned int* line = pixels + y*pWndData->width + left;
+        for ( int x = 0; x < width; x++ )
+        {
+            row[x*3]     = (unsigned char)(line[x] >> 16);
+            row[x*3 + 1] = (unsigned char)(line[x] >> 8);
+            row[x*3 + 2] = (unsigned char)line[x];
+        }
+        fwrite( row.data( ), 1, row.size( ), file );
+    }
+    fclose( file );
+    return true;
+}
+
+
+// There is no window to refresh: these only keep the flag.
+//
+bool getrefreshingbgi( )
+{
+    return BGI__GetWindowDataPtr( )->refreshing;
+}
+
+
+void setrefreshingbgi(bool value)
+{
+    BGI__GetWindowDataPtr( )->refreshing = value;
+}
+
+
+void refreshallbgi( )
+{ }
+
+
+void refreshbgi(int left, int top, int right, int bottom)
+{ }
+
+
+// Drawing takes no lock here, so there is nothing to gain by recording it,
+// and these only keep the flag.
+//
+bool getrecordingbgi( )
+{
+    return BGI__GetWindowDataPtr( )->recording;
+}
+
+
+void setrecordingbgi(bool value)
+{
+    BGI__GetWindowDataPtr( )->recording = value;
+}
+
+
+// There is no lock to hold for the frame either.
+void beginframe( )
+{ }
+
+
+void endframe( )
+{ }
+
+
+/*****************************************************************************
+*
+*   The actual API calls are implemented below
+*
+*****************************************************************************/
+void arc( int x, int y, int stangle, int endangle, int radius )
+{
+    ellipse( x, y, stangle, endangle, radius, radius );
+}
+
+
+// This function fills a 2D bar, left and top included, right and bottom
+// excluded like the GDI FillRect.
+//
+void bar( int left, int top, int right, int bottom )
+{
+    Brush brush = CurrentBrush( BGI__GetWindowDataPtr( ) );
+
+    if ( left > right )
+        std::swap( left, right );
+    if ( top > bottom )
+        std::swap( top, bottom );
+    if ( left == right )
+        return;
+
+    RasterRect bounds = { left, top, right, bottom };
+    BGI__Draw( bounds, [=]( RasterPage& page )
+    {
+        RasterFill fill = brush.Fill( );
+        for ( int y = top; y < bottom; y++ )
+            RasterSpan( page, left, right - 1, y, fill );
+    } );
+}
+
+
+void bar3d( int left, int top, int right, int bottom, int depth, int topflag )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    Pen pen = CurrentPen( pWndData );
+    int dy = (int)(depth * tan( 30.0 * M_PI / 180.0 ));
+    int corners[] = { left, top, right, bottom, left + depth, top - dy, right + depth, bottom - dy };
+
+    bar( left, top, right, bottom );
+    rectangle( left, top, right, bottom );
+
+    BGI__Draw( AroundPoints( 4, corners, pen.thickness ), [=]( RasterPage& page )
+    {
+        if ( depth != 0 )
+        {
+            StyledLine( page, pen, right, bottom, right + depth, bottom - dy );
+            StyledLine( page, pen, right + depth, bottom - dy, right + depth, top - dy );
+            StyledLine( page, pen, right + depth, top - dy, right, top );
+        }
+        if ( topflag != 0 )
+        {
+            StyledLine( page, pen, right + depth, top - dy, left + depth, top - dy );
+            StyledLine( page, pen, left + depth, top - dy, left, top );
+        }
+    } );
+}
+
+
+void circle( int x, int y, int radius )
+{
+    Pen pen = CurrentPen( BGI__GetWindowDataPtr( ) );
+    int r = abs( radius );
+
+    BGI__Draw( Around( x - r, y - r, x + r, y + r, pen.thickness ), [=]( RasterPage& page )
+    {
+        RasterArc( page, x, y, 0, 360, radius, radius, pen.color, pen.thickness );
+    } );
+}
+
+
+// This function clears the whole page (not only the viewport) with the
+// background color and moves the current point to (0,0).  When the page was
+// cleared with the same color before, only what was drawn since is cleared.
+//
+void cleardevice( )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    int page = pWndData->ActivePage;
+    std::vector<unsigned int>& pixels = pWndData->pages[page];
+    int color = converttorgb( pWndData->bgColor );
+    unsigned int pixel = RasterColor( color );
+    RasterDamage& damage = pWndData->damage[page];
+
+    BGI__Flush( );
+    if ( pWndData->clearColor[page] == color )
+        for ( int i = 0; i < damage.count; i++ )
+        {
+            const RasterRect& r = damage.rects[i];
+            for ( int y = r.top; y < r.bottom; y++ )
+                std::fill_n( &pixels[y*pWndData->width + r.left], r.right - r.left, pixel );
+        }
+    else
+        std::fill( pixels.begin( ), pixels.end( ), pixel );
+    RasterDamageClear( damage );
+    pWndData->clearColor[page] = color;
+    moveto( 0, 0 );
+}
+
+
+void clearviewport( )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    RasterFill fill = { BGI__ToPixel( pWndData->bgColor ), 0, NULL };
+    const viewporttype& vp = pWndData->viewportInfo;
+    int width = vp.right - vp.left, height = vp.bottom - vp.top;
+    RasterRect bounds = { 0, 0, width, height };
+
+    BGI__Draw( bounds, [=]( RasterPage& page )
+    {
+        page.xorMode = false;
+        for ( int y = 0; y < height; y++ )
+            RasterSpan( page, 0, width - 1, y, fill );
+    } );
+    moveto( 0, 0 );
+}
+
+
+void drawpoly(int n_points, int* points)
+{
+    Pen pen = CurrentPen( BGI__GetWindowDataPtr( ) );
+
+    if ( n_points < 2 )
+        return;
+    std::vector<int> xy( points, points + n_points*2 );
+    BGI__Draw( AroundPoints( n_points, points, pen.thickness ), [=]( RasterPage& page )
+    {
+        for ( int i = 1; i < n_points; i++ )
+            StyledLine( page, pen, xy[i*2 - 2], xy[i*2 - 1], xy[i*2], xy[i*2 + 1] );
+    } );
+}
+
+
+void ellipse( int x, int y, int stangle, int endangle, int xradius, int yradius )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    Pen pen = CurrentPen( pWndData );
+    int rx = abs( xradius ), ry = abs( yradius );
+
+    BGI__Draw( Around( x - rx, y - ry, x + rx, y + ry, pen.thickness ), [=]( RasterPage& page )
+    {
+        RasterArc( page, x, y, stangle, endangle, xradius, yradius, pen.color, pen.thickness );
+    } );
+    SetArcInfo( pWndData, x, y, xradius, yradius, stangle, endangle );
+}
+
+
+// This function fills an ellipse with the current fill color and pattern and
+// outlines it with the current drawing color, like the GDI Ellipse.
+//
+void fillellipse( int x, int y, int xradius, int yradius )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    Brush brush = CurrentBrush( pWndData );
+    Pen pen = CurrentPen( pWndData );
+    int rx = abs( xradius ), ry = abs( yradius );
+
+    BGI__Draw( Around( x - rx, y - ry, x + rx, y + ry, pen.thickness ), [=]( RasterPage& page )
+    {
+        RasterEllipse( page, x, y, xradius, yradius, brush.Fill( ) );
+        RasterArc( page, x, y, 0, 360, xradius, yradius, pen.color, pen.thickness );
+    } );
+}
+
+
+// This function fills a polygon and outlines it, like the GDI Polygon.
+//
+void fillpoly(int n_points, int* points)
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    Brush brush = CurrentBrush( pWndData );
+    Pen pen = CurrentPen( pWndData );
+
+    if ( n_points < 1 )
+        return;
+    std::vector<int> xy( points, points + n_points*2 );
+    BGI__Draw( AroundPoints( n_points, points, pen.thickness ), [=]( RasterPage& page )
+    {
+        RasterFillPoly( page, n_points, xy.data( ), brush.Fill( ), pen.color, pen.thickness, pen.pattern );
+    } );
+}
+
+
+// Filling reads the page, so what was deferred is drawn first and the fill
+// itself is drawn at once.
+//
+void floodfill( int x, int y, int border )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    Brush brush = CurrentBrush( pWndData );
+
+    BGI__Flush( );
+    RasterPage page = BGI__GetActivePage( );
+    RasterFloodFill( page, x, y, BGI__ToPixel( border ), brush.Fill( ) );
+    BGI__AddDamage( page );
+}
+
+
+void line( int x1, int y1, int x2, int y2 )
+{
+    Pen pen = CurrentPen( BGI__GetWindowDataPtr( ) );
+
+    BGI__Draw( Around( x1, y1, x2, y2, pen.thickness ), [=]( RasterPage& page )
+    {
+        StyledLine( page, pen, x1, y1, x2, y2 );
+    } );
+}
+
+
+void linerel( int dx, int dy )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    lineto( pWndData->cpx + dx, pWndData->cpy + dy );
+}
+
+
+void lineto( int x, int y )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    line( pWndData->cpx, pWndData->cpy, x, y );
+    pWndData->cpx = x;
+    pWndData->cpy = y;
+}
+
+
+void pieslice( int x, int y, int stangle, int endangle, int radius )
+{
+    Pie( BGI__GetWindowDataPtr( ), x, y, stangle, endangle, radius, radius );
+}
+
+
+void putpixel( int x, int y, int color )
+{
+    unsigned int pixel = BGI__ToPixel( color );
+
+    BGI__Draw( Around( x, y, x, y, 0 ), [=]( RasterPage& page )
+    {
+        RasterPixel( page, x, y, pixel );
+    } );
+}
+
+
+// This function plots count pixels at once, (x,y) pairs in xy and the color
+// of the i-th pixel in colors[i].
+//
+void putpixels( int count, const int* xy, const int* colors )
+{
+    if ( count < 1 )
+        return;
+
+    std::vector<int> points( xy, xy + count*2 );
+    std::vector<unsigned int> pixels( count );
+    for ( int i = 0; i < count; i++ )
+        pixels[i] = BGI__ToPixel( colors[i] );
+    BGI__Draw( AroundPoints( count, xy, 0 ), [=]( RasterPage& page )
+    {
+        for ( int i = 0; i < count; i++ )
+            RasterPixel( page, points[i*2], points[i*2 + 1], pixels[i] );
+    } );
+}
+
+
+void rectangle( int left, int top, int right, int bottom )
+{
+    Pen pen = CurrentPen( BGI__GetWindowDataPtr( ) );
+
+    BGI__Draw( Around( left, top, right, bottom, pen.thickness ), [=]( RasterPage& page )
+    {
+        StyledLine( page, pen, left, top, right, top );
+        StyledLine( page, pen, right, top, right, bottom );
+        StyledLine( page, pen, right, bottom, left, bottom );
+        StyledLine( page, pen, left, bottom, left, top );
+    } );
+}
+
+
+void sector( int x, int y, int stangle, int endangle, int xradius, int yradius )
+{
+    Pie( BGI__GetWindowDataPtr( ), x, y, stangle, endangle, xradius, yradius );
+}
+
+
+// This function draws a line of the given thickness with round ends in the
+// drawing color, without touching the line style.
+//
+void thickline( int x1, int y1, int x2, int y2, int thickness )
+{
+    unsigned int color = BGI__ToPixel( BGI__GetWindowDataPtr( )->drawColor );
+
+    BGI__Draw( Around( x1, y1, x2, y2, thickness/2 + 1 ), [=]( RasterPage& page )
+    {
+        RasterCapsule( page, x1, y1, x2, y2, thickness, color );
+    } );
+}
+
+
+/*****************************************************************************
+*
+*   Image functions.  An image is its width and height (two ints) followed by
+*   its pixels.
+*
+*****************************************************************************/
+unsigned int imagesize(int left, int top, int right, int bottom)
+{
+    long width = abs( right - left ) + 1, height = abs( bottom - top ) + 1;
+
+    return (unsigned int)( 2*sizeof( int ) + width*height*sizeof( unsigned int ) );
+}
+
+
+void getimage(int left, int top, int right, int bottom, void *bitmap)
+{
+    BGI__Flush( );
+    RasterPage page = BGI__GetActivePage( );
+    int* header = (int*)bitmap;
+    unsigned int* pixels = (unsigned int*)( header + 2 );
+
+    if ( left > right )
+        std::swap( left, right );
+    if ( top > bottom )
+        std::swap( top, bottom );
+    header[0] = right - left + 1;
+    header[1] = bottom - top + 1;
+    for ( int y = top; y <= bottom; y++ )
+        for ( int x = left; x <= right; x++ )
+            if ( !RasterGetPixel( page, x, y, pixels++ ) )
+                pixels[-1] = 0;
+}
+
+
+// This function puts an image row by row, clipped to the viewport when it
+// asks for clipping, so that it is cheap enough to composite every frame.
+// The image is the caller's and may change once this returns, so it is put
+// at once, after what was deferred.
+//
+void putimage( int left, int top, void *bitmap, int op )
+{
+    BGI__Flush( );
+    RasterPage page = BGI__GetActivePage( );
+    const int* header = (const int*)bitmap;
+    const unsigned int* pixels = (const unsigned int*)( header + 2 );
+    int width = header[0];
+
+    // The part of the image inside the clip rectangle, in page pixels
+    left += page.xorg;
+    top += page.yorg;
+    int x1 = std::max( left, page.left ), x2 = std::min( left + width, page.right );
+    int y1 = std::max( top, page.top ), y2 = std::min( top + header[1], page.bottom );
+    if ( x1 >= x2 || y1 >= y2 )
+        return;
+
+    for ( int y = y1; y < y2; y++ )
+    {
+        const unsigned int* src = pixels + (y - top)*width + (x1 - left);
+        unsigned int* dst = page.pixels + y*page.width + x1;
+        int n = x2 - x1;
+
+        switch ( op )
+        {
+        case XOR_PUT:   for ( int i = 0; i < n; i++ ) dst[i] ^= src[i];                 break;
+        case OR_PUT:    for ( int i = 0; i < n; i++ ) dst[i] |= src[i];                 break;
+        case AND_PUT:   for ( int i = 0; i < n; i++ ) dst[i] &= src[i];                 break;
+        case NOT_PUT:   for ( int i = 0; i < n; i++ ) dst[i] = ~src[i] & 0xFFFFFF;      break;
+        default:        memcpy( dst, src, n * sizeof( unsigned int ) );                 break;
+        }
+    }
+    page.bounds.left = x1;
+    page.bounds.top = y1;
+    page.bounds.right = x2;
+    page.bounds.bottom = y2;
+    BGI__AddDamage( page );
+}
+
+
+// Only the GDI backend can decode image files.
+//
+void readimagefile(
+    const char* filename,
+    int left, int top, int right, int bottom
+    )
+{
+    BGI__GetWindowDataPtr( )->error_code = grIOerror;
+}
+
+
+// This function writes a part of the window to a binary PPM file.
+//
+void writeimagefile(
+    const char* filename,
+    int left, int top, int right, int bottom,
+    bool active, HWND hwnd
+    )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    int page = active ? pWndData->ActivePage : pWndData->VisualPage;
+
+    BGI__Flush( );
+    if ( filename == NULL || !BGI__WritePPM( filename, pWndData->pages[page].data( ), left, top, right, bottom ) )
+        pWndData->error_code = grIOerror;
+}
+
+
+void printimage(
+    const char* title,
+    double width_inches, double border_left_inches, double border_top_inches,
+    int left, int top, int right, int bottom,
+    bool active, HWND hwnd
+    )
+{ }
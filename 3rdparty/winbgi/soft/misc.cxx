@@ -0,0 +1,319 @@
+// File: misc.cxx (software backend)
+//
+// Colors, drawing settings and the other miscellaneous functions of the
+// software backend.  The settings are only stored here: the drawing
+// functions read them when they rasterize.
+//
+
+#include <string.h>         // Provides memcpy
+#include "winbgim.h"        // API routines
+#include "softtypes.h"      // Internal structure data
+#include "pacer.h"          // Provides PacerDelay
+
+
+/*****************************************************************************
+*
+*   Global Variables
+*
+*****************************************************************************/
+// The RGB values for the Borland 16 colors, set in graphdefaults
+int BGI__Colors[16];
+
+
+/*****************************************************************************
+*
+*   Helper functions
+*
+*****************************************************************************/
+unsigned int BGI__ToPixel( int color )
+{
+    return RasterColor( converttorgb( color ) );
+}
+
+
+/*****************************************************************************
+*
+*   The actual API calls are implemented below
+*
+*****************************************************************************/
+int converttorgb( int color )
+{
+    // Convert from BGI color to RGB color
+    if ( IS_BGI_COLOR( color ) )
+        color = BGI__Colors[color];
+    else
+        color &= 0x0FFFFFF;
+
+    return color;
+}
+
+
+// This function pauses for the specified number of milliseconds, unless
+// BGI_NODELAY was set to run as fast as possible.  It sleeps most of it and
+// spins the rest, like the GDI delay (src/pacer.cxx).
+//
+void delay( int msec )
+{
+    if ( BGI__GetWindowDataPtr( ) && BGI__GetWindowDataPtr( )->noDelay )
+        return;
+
+    PacerDelay( msec );
+}
+
+
+void getarccoords( arccoordstype *arccoords )
+{
+    *arccoords = BGI__GetWindowDataPtr( )->arcInfo;
+}
+
+
+int getbkcolor( )
+{
+    return BGI__GetWindowDataPtr( )->bgColor;
+}
+
+
+int getcolor( )
+{
+    return BGI__GetWindowDataPtr( )->drawColor;
+}
+
+
+void getfillpattern( char *pattern )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    memcpy( pattern, pWndData->uPattern, sizeof( pWndData->uPattern ) );
+}
+
+
+void getfillsettings( fillsettingstype *fillinfo )
+{
+    *fillinfo = BGI__GetWindowDataPtr( )->fillInfo;
+}
+
+
+void getlinesettings( linesettingstype *lineinfo )
+{
+    *lineinfo = BGI__GetWindowDataPtr( )->lineInfo;
+}
+
+
+int getmaxcolor( )
+{
+    return WHITE;
+}
+
+
+int getmaxx( )
+{
+    return BGI__GetWindowDataPtr( )->width - 1;
+}
+
+
+int getmaxy( )
+{
+    return BGI__GetWindowDataPtr( )->height - 1;
+}
+
+
+// There is no screen: the largest window is as large as the current one.
+//
+int getmaxheight( )
+{
+    return BGI__GetWindowDataPtr( )->height;
+}
+
+
+int getmaxwidth( )
+{
+    return BGI__GetWindowDataPtr( )->width;
+}
+
+
+// There are no borders either
+//
+int getwindowheight( )
+{
+    return BGI__GetWindowDataPtr( )->height;
+}
+
+
+int getwindowwidth( )
+{
+    return BGI__GetWindowDataPtr( )->width;
+}
+
+
+// Function to convert rgb values to a color that can be used with any bgi
+// functions.  Numbers 0 to WHITE are the original bgi colors. Other colors
+// are 0x03rrggbb.
+//
+int COLOR(int r, int g, int b)
+{
+    int color = RGB(r,g,b);
+
+    for ( int i = 0; i <= WHITE; i++ )
+        if ( color == BGI__Colors[i] )
+            return i;
+
+    return ( 0x03000000 | color );
+}
+
+
+int getdisplaycolor( int color )
+{
+    return COLOR( RED_VALUE( color ), GREEN_VALUE( color ), BLUE_VALUE( color ) );
+}
+
+
+int getpixel( int x, int y )
+{
+    BGI__Flush( );
+    RasterPage page = BGI__GetActivePage( );
+    unsigned int pixel;
+
+    if ( !RasterGetPixel( page, x, y, &pixel ) )
+        return 0;
+
+    int color = RasterToRGB( pixel );
+    return COLOR( GetRValue( color ), GetGValue( color ), GetBValue( color ) );
+}
+
+
+void getviewsettings( viewporttype *viewport )
+{
+    *viewport = BGI__GetWindowDataPtr( )->viewportInfo;
+}
+
+
+int getx( )
+{
+    return BGI__GetWindowDataPtr( )->cpx;
+}
+
+
+int gety( )
+{
+    return BGI__GetWindowDataPtr( )->cpy;
+}
+
+
+void moverel( int dx, int dy )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    pWndData->cpx += dx;
+    pWndData->cpy += dy;
+}
+
+
+void moveto( int x, int y )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    pWndData->cpx = x;
+    pWndData->cpy = y;
+}
+
+
+void setbkcolor( int color )
+{
+    BGI__GetWindowDataPtr( )->bgColor = color;
+}
+
+
+void setcolor( int color )
+{
+    BGI__GetWindowDataPtr( )->drawColor = color;
+}
+
+
+void setlinestyle( int linestyle, unsigned upattern, int thickness )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    pWndData->lineInfo.linestyle = linestyle;
+    pWndData->lineInfo.upattern = upattern;
+    pWndData->lineInfo.thickness = thickness;
+}
+
+
+void setfillpattern( char *upattern, int color )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    memcpy( pWndData->uPattern, upattern, sizeof( pWndData->uPattern ) );
+    pWndData->fillInfo.pattern = USER_FILL;
+    pWndData->fillInfo.color = color;
+}
+
+
+void setfillstyle( int pattern, int color )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    pWndData->fillInfo.pattern = pattern;
+    pWndData->fillInfo.color = color;
+}
+
+
+void setviewport( int left, int top, int right, int bottom, int clip )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    pWndData->viewportInfo.left = left;
+    pWndData->viewportInfo.top = top;
+    pWndData->viewportInfo.right = right;
+    pWndData->viewportInfo.bottom = bottom;
+    pWndData->viewportInfo.clip = clip;
+
+    // Move to the new origin
+    pWndData->cpx = 0;
+    pWndData->cpy = 0;
+}
+
+
+void setwritemode( int mode )
+{
+    if ( mode == COPY_PUT || mode == XOR_PUT )
+        BGI__GetWindowDataPtr( )->writeMode = mode;
+}
+
+
+/*****************************************************************************
+*
+*   Palette functions, which have no effect just like in the GDI backend
+*
+*****************************************************************************/
+palettetype *getdefaultpalette( )
+{
+    static palettetype default_palette = { 16,
+                       { BLACK, BLUE, GREEN, CYAN, RED, MAGENTA, BROWN, LIGHTGRAY,
+                         DARKGRAY, LIGHTBLUE, LIGHTGREEN, LIGHTCYAN, LIGHTRED,
+                         LIGHTMAGENTA, YELLOW, WHITE } };
+
+    return &default_palette;
+}
+
+
+void getpalette( palettetype *palette )
+{ }
+
+
+int getpalettesize( )
+{
+    return MAXCOLORS + 1;
+}
+
+
+void setallpalette( palettetype *palette )
+{ }
+
+
+void setpalette( int colornum, int color )
+{ }
+
+
+void setrgbpalette( int colornum, int red, int green, int blue )
+{ }
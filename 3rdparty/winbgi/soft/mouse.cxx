@@ -0,0 +1,105 @@
+// File: mouse.cxx (software backend)
+//
+// The mouse queues of the software backend.  They are filled by postbgievent
+// (winbgi.cxx) with the same rules as the GDI window procedure: unless
+// queuing is turned on for a kind of event, only the last one is kept.
+// Events are delivered when a frame is presented, which need not happen on
+// the thread reading them, so the queues are only used under inputLock.
+//
+
+#include "winbgim.h"        // API routines
+#include "softtypes.h"      // Internal structure data
+
+/*****************************************************************************
+*
+*   Helper functions
+*
+*****************************************************************************/
+static bool MouseKindInRange( int kind )
+{
+    return ( (kind >= WM_MOUSEFIRST) && (kind <= WM_MOUSELAST) );
+}
+
+
+/*****************************************************************************
+*
+*   The actual API calls are implemented below
+*
+*****************************************************************************/
+bool ismouseclick( int kind )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+    std::lock_guard<std::recursive_mutex> guard( pWndData->inputLock );
+    return ( MouseKindInRange( kind ) && pWndData->clicks[kind - WM_MOUSEFIRST].size( ) );
+}
+
+void clearmouseclick( int kind )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+    std::lock_guard<std::recursive_mutex> guard( pWndData->inputLock );
+
+    // Clear the mouse event
+    if ( MouseKindInRange( kind ) && pWndData->clicks[kind - WM_MOUSEFIRST].size( ) )
+        pWndData->clicks[kind - WM_MOUSEFIRST].pop( );
+}
+
+void clearresizeevent( )
+{ }
+
+void getmouseclick( int kind, int& x, int& y )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+    MousePoint where;
+    std::lock_guard<std::recursive_mutex> guard( pWndData->inputLock );
+
+    // Check if mouse event is in range
+    if ( !MouseKindInRange( kind ) )
+        return;
+
+    // Set position variables to mouse location, or to NO_CLICK if no event occured
+    if ( pWndData->clicks[kind - WM_MOUSEFIRST].size( ) )
+    {
+        where = pWndData->clicks[kind - WM_MOUSEFIRST].front( );
+        pWndData->clicks[kind - WM_MOUSEFIRST].pop( );
+        x = where.x;
+        y = where.y;
+    }
+    else
+    {
+        x = y = NO_CLICK;
+    }
+}
+
+bool isresizeevent( )
+{
+    return false;
+}
+
+void setmousequeuestatus( int kind, bool status )
+{
+    if ( MouseKindInRange( kind ) )
+        BGI__GetWindowDataPtr( )->mouse_queuing[kind - WM_MOUSEFIRST] = status;
+}
+
+int mousex( )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+    std::lock_guard<std::recursive_mutex> guard( pWndData->inputLock );
+    return pWndData->mouse.x;
+}
+
+
+int mousey( )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+    std::lock_guard<std::recursive_mutex> guard( pWndData->inputLock );
+    return pWndData->mouse.y;
+}
+
+
+void registermousehandler( int kind, void h( int, int ) )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+    if ( MouseKindInRange( kind ) )
+        pWndData->mouse_handlers[kind - WM_MOUSEFIRST] = h;
+}
@@ -0,0 +1,149 @@
+// File: softtypes.h
+//
+// Internal structure data of the software backend.  Every page of the window
+// is a plain array of 0x00RRGGBB pixels in memory and nothing is ever shown:
+// presenting a page copies its damaged part to the screen array, frames can be
+// dumped to PPM files and input comes from an event source, so the game can be
+// run and measured headless.
+//
+
+#ifndef SOFTTYPES_H
+#define SOFTTYPES_H
+
+#include <functional>           // Provides STL function class
+#include <mutex>                // Provides STL recursive_mutex class
+#include <queue>                // Provides STL queue class
+#include <string>               // Provides STL string class
+#include <vector>               // Provides STL vector class
+#include "winbgim.h"            // Provides other structures
+#include "raster.h"             // Provides RasterPage and RasterFill
+
+// Define maximum pages used for drawing.
+#define MAX_PAGES 4
+typedef void (*Handler)(int, int);
+
+// ---------------------------------------------------------------------------
+//                              Structures
+// ---------------------------------------------------------------------------
+// A mouse position, as stored in the click queues
+struct MousePoint
+{
+    int x, y;
+};
+
+
+// A drawing call waiting for BGI__Flush (tiles.cxx).  draw is run once for
+// every tile that bounds overlaps, on a copy of page clipped to the tile.
+struct DeferredCall
+{
+    RasterPage page;            // The active page, as the call found it
+    RasterRect bounds;          // The page pixels the call may touch, clipped
+    std::function<void( RasterPage& )> draw;
+};
+
+
+// All the state of the (single) software window
+struct WindowData
+{
+    int width;                  // Width of the pages
+    int height;                 // Height of the pages
+    std::string title;          // Title given to initwindow
+    std::queue<int> kbd_queue;  // Queue of keyboard characters
+    arccoordstype arcInfo;      // Information about the last arc drawn
+    fillsettingstype fillInfo;  // Information about the fill style
+    unsigned char uPattern[8];  // A user-defined fill style
+    linesettingstype lineInfo;  // Information about the line style
+    textsettingstype textInfo;  // Information about the text style
+    viewporttype viewportInfo;  // Information about the viewport
+    std::vector<unsigned int> pages[MAX_PAGES]; // Pixels of each page
+    std::vector<unsigned int> screen; // Pixels presented so far, what a window would show
+    RasterDamage damage[MAX_PAGES]; // What was drawn on each page since it was last cleared
+    int clearColor[MAX_PAGES];  // RGB color of the last cleardevice of each page, -1 if unknown
+    RasterDamage presented;     // Damage of the page on the screen when it was presented
+    int presentedColor;         // Its clearColor
+    int VisualPage;             // The page that is presented
+    int ActivePage;             // The page that is drawn into
+    bool DoubleBuffer;          // Whether the user wants a double buffered window
+    bool CloseBehavior;         // false (do nothing); true (exit program)
+    int drawColor;              // The current drawing color (That the user gave us)
+    int bgColor;                // The current background color (That the user gave us)
+    int writeMode;              // COPY_PUT or XOR_PUT
+    int cpx, cpy;               // The current position (viewport relative)
+    int error_code;             // Error code used by graphresult (usually grOk)
+    int x_aspect_ratio;         // Horizontal Aspect Ratio
+    int y_aspect_ratio;         // Vertical Aspect Ratio
+    int t_scale[4];             // scaling factor for fonts multx, divx, multy, divy
+    MousePoint mouse;           // Current location of the mouse
+    std::queue<MousePoint> clicks[WM_MOUSELAST - WM_MOUSEFIRST + 1];   // Array to hold the coordinates of the clicks
+    bool mouse_queuing[WM_MOUSELAST - WM_MOUSEFIRST + 1]; // Array to tell whether mouse events should be queued
+    Handler mouse_handlers[WM_MOUSELAST - WM_MOUSEFIRST + 1];   // Array of mouse event handlers
+    bool refreshing;            // Kept for getrefreshingbgi, there is nothing to refresh
+    bool recording;             // Kept for getrecordingbgi, drawing takes no lock here
+    unsigned frame;             // Number of frames presented so far
+    std::string dumpPattern;    // printf pattern of the PPM file per frame, empty for none
+    bgieventsource eventSource; // Where the input comes from (NULL for none)
+    std::recursive_mutex inputLock; // Taken for the input queues and the event source, which
+                                // may be used by another thread than the one presenting
+    bool noDelay;               // Whether delay returns at once (BGI_NODELAY)
+    int threads;                // Threads drawing the tiles (BGI_THREADS), 1 draws every call at once
+    std::vector<DeferredCall> deferred; // Calls of the active page not drawn yet
+};
+
+
+// ---------------------------------------------------------------------------
+//                              Prototypes
+// ---------------------------------------------------------------------------
+// Returns a pointer to the window data structure (winbgi.cxx)
+WindowData* BGI__GetWindowDataPtr( );
+
+// Returns the active page, clipped and translated by the viewport (drawing.cxx)
+RasterPage BGI__GetActivePage( );
+
+// Adds what was drawn into a page given by BGI__GetActivePage to the damage
+// of the active page (drawing.cxx)
+void BGI__AddDamage( const RasterPage& page );
+
+// Queues a drawing call for the tiles.  bounds are the pixels it may touch,
+// in viewport coordinates (tiles.cxx)
+void BGI__Defer( const RasterRect& bounds, const std::function<void( RasterPage& )>& draw );
+
+// Draws the queued calls into the active page, before anything reads it,
+// clears it, or stops drawing into it (tiles.cxx)
+void BGI__Flush( );
+
+// Runs draw on the active page and adds what it drew to the damage, or
+// defers it to the tiles when there are threads for them.  bounds must hold
+// every pixel draw may touch, in viewport coordinates, right and bottom
+// excluded.
+template <class Draw>
+void BGI__Draw( const RasterRect& bounds, const Draw& draw )
+{
+    if ( BGI__GetWindowDataPtr( )->threads > 1 )
+    {
+        BGI__Defer( bounds, draw );
+        return;
+    }
+    RasterPage page = BGI__GetActivePage( );
+    draw( page );
+    BGI__AddDamage( page );
+}
+
+// Copies the damaged part of the visual page to the screen (drawing.cxx)
+void BGI__Present( );
+
+// Converts a BGI or RGB color into a page pixel (misc.cxx)
+unsigned int BGI__ToPixel( int color );
+
+// Delivers the events that are due at the current frame (winbgi.cxx)
+void BGI__PumpEvents( );
+
+// Writes a part of a page (or of the screen) to a binary PPM file (drawing.cxx)
+bool BGI__WritePPM( const char* filename, const unsigned int* pixels, int left, int top, int right, int bottom );
+
+// ---------------------------------------------------------------------------
+//                            Global Variables
+// ---------------------------------------------------------------------------
+extern int BGI__Colors[16];     // The RGB values for the Borland 16 colors, misc.cxx
+
+
+#endif  // SOFTTYPES_H
@@ -0,0 +1,389 @@
+// File: text.cxx (software backend)
+//
+// Text output of the software backend.  Every font is drawn with the same
+// 8x8 bitmap font, stretched to the cell size the GDI backend asks Windows
+// for (font_metrics), so that textwidth and textheight stay close to the
+// sizes the game was laid out with.
+//
+
+#include <string.h>         // Provides strlen
+#include <sstream>          // Provides ostringstream
+#include <string>           // Provides string
+#include "winbgim.h"        // API routines
+#include "softtypes.h"      // Internal structure data
+
+
+/*****************************************************************************
+*
+*   Some very useful arrays -- Same as the GDI backend for consistency
+*   Also, the exported definition of bgiout.
+*
+*****************************************************************************/
+std::ostringstream bgiout;
+
+static struct { int width; int height; } font_metrics[][11] = {
+    {{0,0},{8,8},{16,16},{24,24},{32,32},{40,40},{48,48},{56,56},{64,64},{72,72},{80,80}}, // DefaultFont
+    {{0,0},{13,18},{14,20},{16,23},{22,31},{29,41},{36,51},{44,62},{55,77},{66,93},{88,124}}, // TriplexFont
+    {{0,0},{3,5},{4,6},{4,6},{6,9},{8,12},{10,15},{12,18},{15,22},{18,27},{24,36}}, // SmallFont
+    {{0,0},{11,19},{12,21},{14,24},{19,32},{25,42},{31,53},{38,64},{47,80},{57,96},{76,128}}, // SansSerifFont
+    {{0,0},{13,19},{14,21},{16,24},{22,32},{29,42},{36,53},{44,64},{55,80},{66,96},{88,128}}, // GothicFont
+
+    // These may not be 100% correct
+    {{0,0},{11,19},{12,21},{14,24},{19,32},{25,42},{31,53},{38,64},{47,80},{57,96},{76,128}}, // ScriptFont
+    {{0,0},{11,19},{12,21},{14,24},{19,32},{25,42},{31,53},{38,64},{47,80},{57,96},{76,128}}, // SimplexFont
+    {{0,0},{13,18},{14,20},{16,23},{22,31},{29,41},{36,51},{44,62},{55,77},{66,93},{88,124}}, // TriplexScriptFont
+    {{0,0},{11,19},{12,21},{14,24},{19,32},{25,42},{31,53},{38,64},{47,80},{57,96},{76,128}}, // ComplexFont
+    {{0,0},{11,19},{12,21},{14,24},{19,32},{25,42},{31,53},{38,64},{47,80},{57,96},{76,128}}, // EuropeanFont
+    {{0,0},{11,19},{12,21},{14,24},{19,32},{25,42},{31,53},{38,64},{47,80},{57,96},{76,128}} // BoldFont
+};
+
+// The printable ASCII characters (0x20 to 0x7E), one byte per row, least
+// significant bit leftmost.  Other characters are drawn as '?'.
+static const unsigned char font8x8[95][8] =
+{
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // 0x20
+    { 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 },   // !
+    { 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // "
+    { 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 },   // #
+    { 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 },   // $
+    { 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 },   // %
+    { 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 },   // &
+    { 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 },   // '
+    { 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 },   // (
+    { 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 },   // )
+    { 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 },   // *
+    { 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 },   // +
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 },   // ,
+    { 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 },   // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 },   // .
+    { 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 },   // /
+    { 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 },   // 0
+    { 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 },   // 1
+    { 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 },   // 2
+    { 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 },   // 3
+    { 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 },   // 4
+    { 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 },   // 5
+    { 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 },   // 6
+    { 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 },   // 7
+    { 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 },   // 8
+    { 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 },   // 9
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 },   // :
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 },   // ;
+    { 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 },   // <
+    { 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 },   // =
+    { 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 },   // >
+    { 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 },   // ?
+    { 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 },   // @
+    { 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 },   // A
+    { 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 },   // B
+    { 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 },   // C
+    { 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 },   // D
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 },   // E
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 },   // F
+    { 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 },   // G
+    { 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 },   // H
+    { 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },   // I
+    { 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 },   // J
+    { 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 },   // K
+    { 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 },   // L
+    { 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 },   // M
+    { 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 },   // N
+    { 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 },   // O
+    { 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 },   // P
+    { 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 },   // Q
+    { 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 },   // R
+    { 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 },   // S
+    { 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },   // T
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 },   // U
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },   // V
+    { 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 },   // W
+    { 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 },   // X
+    { 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 },   // Y
+    { 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 },   // Z
+    { 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 },   // [
+    { 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 },   // 0x5C
+    { 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 },   // ]
+    { 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 },   // ^
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF },   // _
+    { 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 },   // `
+    { 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 },   // a
+    { 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 },   // b
+    { 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 },   // c
+    { 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 },   // d
+    { 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 },   // e
+    { 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 },   // f
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F },   // g
+    { 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 },   // h
+    { 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },   // i
+    { 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E },   // j
+    { 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 },   // k
+    { 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },   // l
+    { 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 },   // m
+    { 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 },   // n
+    { 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 },   // o
+    { 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F },   // p
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 },   // q
+    { 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 },   // r
+    { 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 },   // s
+    { 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 },   // t
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 },   // u
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },   // v
+    { 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 },   // w
+    { 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 },   // x
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F },   // y
+    { 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 },   // z
+    { 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 },   // {
+    { 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 },   // |
+    { 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 },   // }
+    { 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // ~
+};
+
+
+/*****************************************************************************
+*
+*   Some helper functions
+*
+*****************************************************************************/
+// This function returns the size of a character cell with the current
+// text settings.
+//
+static void cell_size( WindowData* pWndData, int* width, int* height )
+{
+    int font = pWndData->textInfo.font;
+    int charsize = pWndData->textInfo.charsize;
+
+    if ( font < DEFAULT_FONT || font > BOLD_FONT )
+        font = DEFAULT_FONT;
+
+    // get the scaling factors based on charsize
+    if ( charsize == USER_CHAR_SIZE )
+    {
+        double xscale = double( pWndData->t_scale[0] ) / pWndData->t_scale[1];
+        double yscale = double( pWndData->t_scale[2] ) / pWndData->t_scale[3];
+
+        // if font zero, only use factors.. else also multiply by 4
+        int mindex = ( font == DEFAULT_FONT ) ? 1 : 4;
+        *width = int( font_metrics[font][mindex].width * xscale );
+        *height = int( font_metrics[font][mindex].height * yscale );
+    }
+    else
+    {
+        if ( charsize < 1 || charsize > 10 )
+            charsize = 1;
+        *width = font_metrics[font][charsize].width;
+        *height = font_metrics[font][charsize].height;
+    }
+}
+
+
+// This function draws textstring with its top left corner at (x,y), or with
+// its bottom left corner there for vertical text, which goes upwards.
+//
+static void draw_text( WindowData* pWndData, int x, int y, const char* textstring )
+{
+    RasterFill fill = { BGI__ToPixel( pWndData->drawColor ), 0, NULL };
+    bool vertical = pWndData->textInfo.direction == VERT_DIR;
+    std::string text( textstring );
+    int w, h;
+
+    cell_size( pWndData, &w, &h );
+    // The cells of the text, and a pixel around for cells too small to draw
+    int length = w * (int)text.length( );
+    RasterRect bounds = { x - 1, y - 1, x + length + 1, y + h + 1 };
+    if ( vertical )
+    {
+        bounds.left = x - 1;
+        bounds.top = y - length;
+        bounds.right = x + h + 1;
+        bounds.bottom = y + 2;
+    }
+
+    BGI__Draw( bounds, [=]( RasterPage& page )
+    {
+        int cx = x, cy = y;
+        for ( size_t i = 0; i < text.length( ); i++ )
+        {
+            unsigned char c = text[i];
+            const unsigned char* glyph = font8x8[( c >= 0x20 && c < 0x7F ) ? c - 0x20 : '?' - 0x20];
+
+            for ( int gy = 0; gy < 8; gy++ )
+            {
+                int y1 = gy*h/8, y2 = (gy + 1)*h/8 - 1;
+
+                // Runs of set bits become one span per pixel row
+                for ( int gx = 0; gx < 8; )
+                {
+                    if ( !(glyph[gy] & (1 << gx)) )
+                    {
+                        gx++;
+                        continue;
+                    }
+                    int start = gx;
+                    while ( gx < 8 && (glyph[gy] & (1 << gx)) )
+                        gx++;
+                    int x1 = start*w/8, x2 = gx*w/8 - 1;
+
+                    if ( !vertical )
+                        for ( int py = y1; py <= y2; py++ )
+                            RasterSpan( page, cx + x1, cx + x2, cy + py, fill );
+                    else
+                        for ( int px = x1; px <= x2; px++ )
+                            RasterSpan( page, cx + y1, cx + y2, cy - px, fill );
+                }
+            }
+
+            if ( !vertical )
+                cx += w;
+            else
+                cy -= w;
+        }
+    } );
+}
+
+
+// This function draws textstring at (x,y) with the current justification.
+// POSTCONDITION: the text has been drawn; its length in pixels is returned.
+//
+static int justified_text( WindowData* pWndData, int x, int y, const char* textstring )
+{
+    int w, h;
+    int length = (int)strlen( textstring );
+    int along, across;
+
+    cell_size( pWndData, &w, &h );
+    length *= w;
+
+    // Offsets along and across the direction of the text
+    along = ( pWndData->textInfo.horiz == CENTER_TEXT ) ? length/2 :
+            ( pWndData->textInfo.horiz == RIGHT_TEXT ) ? length : 0;
+    across = ( pWndData->textInfo.vert == VCENTER_TEXT ) ? h/2 :
+             ( pWndData->textInfo.vert == BOTTOM_TEXT ) ? h : 0;
+
+    if ( pWndData->textInfo.direction == VERT_DIR )
+        draw_text( pWndData, x - across, y + along, textstring );
+    else
+        draw_text( pWndData, x - along, y - across, textstring );
+    return length;
+}
+
+
+/*****************************************************************************
+*
+*   The actual API calls are implemented below
+*
+*****************************************************************************/
+void gettextsettings(struct textsettingstype *texttypeinfo)
+{
+    // if its null, leave.
+    if (!texttypeinfo)
+        return;
+
+    *texttypeinfo = BGI__GetWindowDataPtr( )->textInfo;
+}
+
+
+// This function prints textstring at the current position and, when the
+// text is left justified, moves the current position past it.
+//
+void outtext(char *textstring)
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    int advance = justified_text( pWndData, pWndData->cpx, pWndData->cpy, textstring );
+
+    if ( pWndData->textInfo.horiz != LEFT_TEXT )
+        return;
+    if ( pWndData->textInfo.direction == VERT_DIR )
+        pWndData->cpy -= advance;
+    else
+        pWndData->cpx += advance;
+}
+
+
+void outtextxy(int x, int y, char *textstring)
+{
+    justified_text( BGI__GetWindowDataPtr( ), x, y, textstring );
+}
+
+
+void settextjustify(int horiz, int vert)
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    pWndData->textInfo.horiz = horiz;
+    pWndData->textInfo.vert  = vert;
+}
+
+
+void settextstyle(int font, int direction, int charsize)
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    pWndData->textInfo.font = font;
+    pWndData->textInfo.direction = direction;
+    pWndData->textInfo.charsize = charsize;
+}
+
+
+void setusercharsize(int multx, int divx, int multy, int divy)
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    if ( divx == 0 || divy == 0 )
+        return;
+    pWndData->t_scale[0] = multx;
+    pWndData->t_scale[1] = divx;
+    pWndData->t_scale[2] = multy;
+    pWndData->t_scale[3] = divy;
+}
+
+
+int textheight(char *textstring)
+{
+    int w, h;
+
+    cell_size( BGI__GetWindowDataPtr( ), &w, &h );
+    return h;
+}
+
+
+int textwidth(char *textstring)
+{
+    int w, h;
+
+    cell_size( BGI__GetWindowDataPtr( ), &w, &h );
+    return w * (int)strlen( textstring );
+}
+
+
+void outstreamxy(int x, int y, std::ostringstream& out)
+{
+    std::string all, line;
+    int startx = x;
+
+    all = out.str( );
+    out.str("");
+
+    moveto(x,y);
+    for (size_t i = 0; i < all.length( ); i++)
+    {
+        if (all[i] == '\n')
+        {
+            if (line.length( ) > 0)
+                outtext((char *) line.c_str( ));
+            y += textheight((char *) "X");
+            x = startx;
+            line.clear( );
+            moveto(x,y);
+        }
+        else
+            line += all[i];
+    }
+    if (line.length( ) > 0)
+        outtext((char *) line.c_str( ));
+}
+
+
+void outstream(std::ostringstream& out)
+{
+    outstreamxy(getx( ), gety( ), out);
+}
@@ -0,0 +1,200 @@
+// File: tiles.cxx (software backend)
+//
+// Tile-parallel rasterization.  When the window has more than one thread to
+// draw with (BGI_THREADS), the drawing calls are not rasterized at once but
+// queued with the page pixels they may touch.  BGI__Flush then splits the
+// page into tiles, bins every call into the tiles it overlaps and lets a pool
+// of threads draw the tiles, each call clipped to its tile.  Every tile sees
+// its calls in order and the Raster functions write the same pixels whatever
+// the clip rectangle, so the page ends up exactly as if drawn at once.
+//
+
+#include <algorithm>        // Provides std::min, std::max
+#include <atomic>           // Provides std::atomic
+#include <condition_variable> // Provides std::condition_variable
+#include <mutex>            // Provides std::mutex, std::unique_lock
+#include <thread>           // Provides std::thread
+#include <vector>           // Provides std::vector
+#include "winbgim.h"        // API routines
+#include "softtypes.h"      // Internal structure data
+
+// Tiles are squares of TILE_SIZE pixels, smaller at the right and bottom edges
+#define TILE_SIZE 128
+
+
+/*****************************************************************************
+*
+*   The pool of threads drawing the tiles
+*
+*****************************************************************************/
+// The workers sleep until a flush bumps generation, then take tiles from
+// next until there are none left.  The thread flushing draws tiles too and
+// waits until busy says every worker is done with the generation.
+//
+class TileWorkers
+{
+public:
+    TileWorkers( ) : generation( 0 ), busy( 0 ), quit( false ), count( 0 ), job( NULL )
+    { }
+
+    ~TileWorkers( )
+    {
+        {
+            std::lock_guard<std::mutex> guard( lock );
+            quit = true;
+        }
+        wake.notify_all( );
+        for ( size_t i = 0; i < threads.size( ); i++ )
+            threads[i].join( );
+    }
+
+    // Calls draw for the tiles 0..tiles-1 on threads threads, this one included
+    void Run( int n_threads, int tiles, void (*draw)( int ) )
+    {
+        while ( (int)threads.size( ) < n_threads - 1 )
+            threads.push_back( std::thread( &TileWorkers::Work, this ) );
+
+        {
+            std::lock_guard<std::mutex> guard( lock );
+            count = tiles;
+            job = draw;
+            next = 0;
+            busy = (int)threads.size( );
+            generation++;
+        }
+        wake.notify_all( );
+        DrawTiles( );
+
+        std::unique_lock<std::mutex> guard( lock );
+        idle.wait( guard, [this]{ return busy == 0; } );
+    }
+
+private:
+    void DrawTiles( )
+    {
+        for ( int tile; (tile = next++) < count; )
+            job( tile );
+    }
+
+    void Work( )
+    {
+        unsigned seen = 0;
+
+        for ( ;; )
+        {
+            {
+                std::unique_lock<std::mutex> guard( lock );
+                wake.wait( guard, [&]{ return quit || generation != seen; } );
+                if ( quit )
+                    return;
+                seen = generation;
+            }
+            DrawTiles( );
+            {
+                std::lock_guard<std::mutex> guard( lock );
+                if ( --busy == 0 )
+                    idle.notify_one( );
+            }
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    std::condition_variable wake;   // A new generation of tiles, or quit
+    std::condition_variable idle;   // busy dropped to zero
+    unsigned generation;            // Number of flushes so far
+    int busy;                       // Workers still drawing this generation
+    bool quit;
+    std::atomic<int> next;          // The next tile to draw
+    int count;                      // The number of tiles
+    void (*job)( int );             // Draws a tile
+};
+
+static TileWorkers BGI__TileWorkers;
+
+// The calls overlapping each tile, and what each tile drew, for the flush
+// under way.  They are kept across flushes so that their storage is reused.
+static std::vector< std::vector<int> > BGI__TileCalls;
+static std::vector<RasterRect> BGI__TileBounds;
+static int BGI__TileColumns;
+
+
+/*****************************************************************************
+*
+*   Helper functions
+*
+*****************************************************************************/
+// This function draws the calls binned into a tile, each clipped to the tile.
+//
+static void DrawTile( int tile )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    const std::vector<int>& calls = BGI__TileCalls[tile];
+    int left = (tile % BGI__TileColumns) * TILE_SIZE, top = (tile / BGI__TileColumns) * TILE_SIZE;
+    RasterRect bounds = RasterEmptyRect( );
+
+    for ( size_t i = 0; i < calls.size( ); i++ )
+    {
+        const DeferredCall& call = pWndData->deferred[calls[i]];
+        RasterPage page = call.page;
+
+        page.left = std::max( page.left, left );
+        page.top = std::max( page.top, top );
+        page.right = std::min( page.right, left + TILE_SIZE );
+        page.bottom = std::min( page.bottom, top + TILE_SIZE );
+        page.bounds = bounds;
+        call.draw( page );
+        bounds = page.bounds;
+    }
+    BGI__TileBounds[tile] = bounds;
+}
+
+
+void BGI__Defer( const RasterRect& bounds, const std::function<void( RasterPage& )>& draw )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    DeferredCall call;
+
+    call.page = BGI__GetActivePage( );
+    call.bounds.left = std::max( bounds.left + call.page.xorg, call.page.left );
+    call.bounds.top = std::max( bounds.top + call.page.yorg, call.page.top );
+    call.bounds.right = std::min( bounds.right + call.page.xorg, call.page.right );
+    call.bounds.bottom = std::min( bounds.bottom + call.page.yorg, call.page.bottom );
+    if ( call.bounds.left >= call.bounds.right || call.bounds.top >= call.bounds.bottom )
+        return;
+    call.draw = draw;
+    pWndData->deferred.push_back( call );
+}
+
+
+void BGI__Flush( )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    std::vector<DeferredCall>& deferred = pWndData->deferred;
+
+    if ( deferred.empty( ) )
+        return;
+
+    // Bin the calls
+    int columns = (pWndData->width + TILE_SIZE - 1) / TILE_SIZE;
+    int rows = (pWndData->height + TILE_SIZE - 1) / TILE_SIZE;
+    BGI__TileColumns = columns;
+    BGI__TileCalls.resize( columns * rows );
+    BGI__TileBounds.resize( columns * rows );
+    for ( size_t i = 0; i < BGI__TileCalls.size( ); i++ )
+        BGI__TileCalls[i].clear( );
+    for ( size_t i = 0; i < deferred.size( ); i++ )
+    {
+        const RasterRect& r = deferred[i].bounds;
+        for ( int ty = r.top / TILE_SIZE; ty <= (r.bottom - 1) / TILE_SIZE; ty++ )
+            for ( int tx = r.left / TILE_SIZE; tx <= (r.right - 1) / TILE_SIZE; tx++ )
+                BGI__TileCalls[ty*columns + tx].push_back( (int)i );
+    }
+
+    BGI__TileWorkers.Run( pWndData->threads, columns * rows, DrawTile );
+
+    for ( size_t i = 0; i < BGI__TileBounds.size( ); i++ )
+        RasterDamageAdd( pWndData->damage[pWndData->ActivePage], BGI__TileBounds[i],
+                         pWndData->width, pWndData->height );
+    deferred.clear( );
+}
@@ -0,0 +1,595 @@
+// File: winbgi.cxx (software backend)
+//
+// Window creation, pages and input of the software backend.  There is a
+// single window whose pages live in memory.  Each swapbuffers is one frame:
+// it is dumped to a PPM file when a dump pattern is set, and then the input
+// events due at the new frame are delivered.
+//
+// Environment variables read by initwindow:
+//   BGI_REPLAY=file     Input is replayed from file, one event per line:
+//                           <frame> move|down|up|rdown|rup <x> <y>
+//                           <frame> key <character>
+//                           <frame> close
+//                           <frame> quit
+//                       close behaves like closing the window, quit ends the
+//                       program whatever closeflag was.  Lines starting with
+//                       # are ignored.
+//   BGI_DUMP=pattern    Every frame is written to a PPM file named by the
+//                       printf pattern with the frame number (frame%05d.ppm).
+//   BGI_NODELAY         Calls to delay return at once.
+//   BGI_THREADS=n       Frames are drawn by tiles on n threads (tiles.cxx).
+//                       It defaults to the number of cores, and 1 draws
+//                       every call at once on the calling thread.
+//
+
+#include <stdio.h>          // Provides FILE, fopen, snprintf, fprintf
+#include <stdlib.h>         // Provides getenv, atoi, exit
+#include <string.h>         // Provides strcmp, memset
+#include <algorithm>        // Provides std::max
+#include <thread>           // Provides std::thread::hardware_concurrency
+#include "winbgim.h"        // API routines
+#include "softtypes.h"      // Internal structure data
+
+
+/*****************************************************************************
+*
+*   Global Variables
+*
+*****************************************************************************/
+static WindowData* BGI__Window = NULL;     // The one and only window
+static FILE* BGI__ReplayFile = NULL;       // Opened from BGI_REPLAY
+static bgievent BGI__ReplayNext;           // Event read ahead from the file
+static unsigned BGI__ReplayFrame;          // Frame of BGI__ReplayNext
+static bool BGI__ReplayPending = false;    // Whether BGI__ReplayNext is valid
+
+
+/*****************************************************************************
+*
+*   Helper functions
+*
+*****************************************************************************/
+// Reads the next event of the replay file into BGI__ReplayNext
+//
+static void ReadReplayEvent( )
+{
+    char line[256], kind[16], key[16];
+    unsigned frame;
+    int x, y;
+
+    BGI__ReplayPending = false;
+    while ( BGI__ReplayFile && fgets( line, sizeof( line ), BGI__ReplayFile ) )
+    {
+        if ( line[0] == '#' || sscanf( line, "%u %15s", &frame, kind ) != 2 )
+            continue;
+
+        BGI__ReplayFrame = frame;
+        BGI__ReplayNext.x = BGI__ReplayNext.y = 0;
+        if ( strcmp( kind, "key" ) == 0 && sscanf( line, "%*u %*s %15s", key ) == 1 )
+        {
+            BGI__ReplayNext.kind = BGI_KEY;
+            BGI__ReplayNext.x = (unsigned char)key[0];
+        }
+        else if ( strcmp( kind, "close" ) == 0 )
+            BGI__ReplayNext.kind = BGI_CLOSE;
+        else if ( strcmp( kind, "quit" ) == 0 )
+            BGI__ReplayNext.kind = 0;      // Not an event: ends the program
+        else if ( sscanf( line, "%*u %*s %d %d", &x, &y ) == 2 )
+        {
+            if ( strcmp( kind, "move" ) == 0 )        BGI__ReplayNext.kind = WM_MOUSEMOVE;
+            else if ( strcmp( kind, "down" ) == 0 )   BGI__ReplayNext.kind = WM_LBUTTONDOWN;
+            else if ( strcmp( kind, "up" ) == 0 )     BGI__ReplayNext.kind = WM_LBUTTONUP;
+            else if ( strcmp( kind, "rdown" ) == 0 )  BGI__ReplayNext.kind = WM_RBUTTONDOWN;
+            else if ( strcmp( kind, "rup" ) == 0 )    BGI__ReplayNext.kind = WM_RBUTTONUP;
+            else continue;
+            BGI__ReplayNext.x = x;
+            BGI__ReplayNext.y = y;
+        }
+        else
+            continue;
+
+        BGI__ReplayPending = true;
+        return;
+    }
+}
+
+
+// The event source reading the BGI_REPLAY file
+//
+static bool ReplaySource( unsigned frame, bgievent *event )
+{
+    if ( !BGI__ReplayPending || BGI__ReplayFrame > frame )
+        return false;
+
+    *event = BGI__ReplayNext;
+    ReadReplayEvent( );
+    if ( event->kind == 0 )
+        exit( 0 );
+    return true;
+}
+
+
+// Writes the screen to the dump file of the current frame, if any
+//
+static void DumpFrame( WindowData* pWndData )
+{
+    char filename[1024];
+
+    if ( pWndData->dumpPattern.empty( ) )
+        return;
+
+    snprintf( filename, sizeof( filename ), pWndData->dumpPattern.c_str( ), pWndData->frame );
+    BGI__WritePPM( filename, pWndData->screen.data( ), 0, 0, pWndData->width - 1, pWndData->height - 1 );
+}
+
+
+WindowData* BGI__GetWindowDataPtr( )
+{
+    return BGI__Window;
+}
+
+
+void BGI__PumpEvents( )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    bgievent event;
+    std::lock_guard<std::recursive_mutex> guard( pWndData->inputLock );
+
+    while ( pWndData->eventSource && pWndData->eventSource( pWndData->frame, &event ) )
+        postbgievent( event.kind, event.x, event.y );
+}
+
+
+/*****************************************************************************
+*
+*   The actual API calls are implemented below
+*
+*****************************************************************************/
+// There is no window to show a message box in: the message goes to stderr.
+//
+void showerrorbox( const char* msg )
+{
+    fprintf( stderr, "%s\n", msg ? msg : "BGI error" );
+}
+
+
+// This function restores all the settings to their default values.
+//
+void graphdefaults( )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+
+    // Set viewport to the entire screen and move current position to (0,0)
+    setviewport( 0, 0, pWndData->width, pWndData->height, 0 );
+    pWndData->mouse.x = 0;
+    pWndData->mouse.y = 0;
+
+    pWndData->refreshing = true;
+    pWndData->recording = false;
+
+    // The same colors as the GDI backend
+    BGI__Colors[0] = RGB( 0, 0, 0 );         // Black
+    BGI__Colors[1] = RGB( 0, 0, 128);        // Blue
+    BGI__Colors[2] = RGB( 0, 128, 0 );       // Green
+    BGI__Colors[3] = RGB( 0, 128, 128 );     // Cyan
+    BGI__Colors[4] = RGB( 128, 0, 0 );       // Red
+    BGI__Colors[5] = RGB( 128, 0, 128 );     // Magenta
+    BGI__Colors[6] = RGB( 128, 128, 0 );     // Brown
+    BGI__Colors[7] = RGB( 192, 192, 192 );   // Light Gray
+    BGI__Colors[8] = RGB( 128, 128, 128 );   // Dark Gray
+    BGI__Colors[9] = RGB( 128, 128, 255 );   // Light Blue
+    BGI__Colors[10] = RGB( 128, 255, 128 );  // Light Green
+    BGI__Colors[11] = RGB( 128, 255, 255 );  // Light Cyan
+    BGI__Colors[12] = RGB( 255, 128, 128 );  // Light Red
+    BGI__Colors[13] = RGB( 255, 128, 255 );  // Light Magenta
+    BGI__Colors[14] = RGB( 255, 255, 0 );    // Yellow
+    BGI__Colors[15] = RGB( 255, 255, 255 );  // White
+
+    pWndData->bgColor = BLACK;
+    pWndData->drawColor = WHITE;
+    pWndData->writeMode = COPY_PUT;
+    pWndData->fillInfo.pattern = SOLID_FILL;
+    pWndData->fillInfo.color = WHITE;
+
+    pWndData->textInfo.horiz = LEFT_TEXT;
+    pWndData->textInfo.vert = TOP_TEXT;
+    pWndData->textInfo.font = DEFAULT_FONT;
+    pWndData->textInfo.direction = HORIZ_DIR;
+    pWndData->textInfo.charsize = 1;
+
+    pWndData->t_scale[0] = 1; // multx
+    pWndData->t_scale[1] = 1; // divx
+    pWndData->t_scale[2] = 1; // multy
+    pWndData->t_scale[3] = 1; // divy
+
+    pWndData->error_code = grOk;
+
+    pWndData->lineInfo.linestyle = SOLID_LINE;
+    pWndData->lineInfo.upattern = 0xFFFF;
+    pWndData->lineInfo.thickness = NORM_WIDTH;
+
+    // Set the default active and visual page
+    if ( pWndData->DoubleBuffer )
+    {
+        pWndData->ActivePage = 1;
+        pWndData->VisualPage = 0;
+    }
+    else
+    {
+        pWndData->ActivePage = 0;
+        pWndData->VisualPage = 0;
+    }
+
+    pWndData->x_aspect_ratio = 10000;
+    pWndData->y_aspect_ratio = 10000;
+}
+
+
+// This function creates the window, which only exists in memory.  Only one
+// window is supported: a second call replaces the first one.
+// RETURN VALUE: 0, the index of the window.  On failure, -1.
+//
+int initwindow
+( int width, int height, const char* title, int left, int top, bool dbflag , bool closeflag)
+{
+    const char* env;
+
+    if ( width <= 0 || height <= 0 )
+        return -1;
+
+    delete BGI__Window;
+    WindowData* pWndData = BGI__Window = new WindowData;
+
+    pWndData->width = width;
+    pWndData->height = height;
+    pWndData->title = title ? title : "";
+    for ( int i = 0; i < MAX_PAGES; i++ )
+    {
+        pWndData->pages[i].assign( (size_t)width * height, 0 );
+        RasterDamageClear( pWndData->damage[i] );
+        pWndData->clearColor[i] = RGB( 0, 0, 0 );
+    }
+    // The pages and the screen start out black and undamaged
+    pWndData->screen.assign( (size_t)width * height, 0 );
+    RasterDamageClear( pWndData->presented );
+    pWndData->presentedColor = RGB( 0, 0, 0 );
+
+    memset( pWndData->uPattern, 0, sizeof( pWndData->uPattern ) );
+    memset( pWndData->mouse_handlers, 0, sizeof( pWndData->mouse_handlers ) );
+    memset( pWndData->mouse_queuing, 0, sizeof( pWndData->mouse_queuing ) );
+    pWndData->DoubleBuffer = dbflag;
+    pWndData->CloseBehavior = closeflag;
+    pWndData->frame = 0;
+    pWndData->eventSource = NULL;
+
+    // Headless settings from the environment
+    env = getenv( "BGI_DUMP" );
+    pWndData->dumpPattern = env ? env : "";
+    pWndData->noDelay = getenv( "BGI_NODELAY" ) != NULL;
+    env = getenv( "BGI_THREADS" );
+    pWndData->threads = env ? atoi( env ) : (int)std::thread::hardware_concurrency( );
+    pWndData->threads = std::max( pWndData->threads, 1 );
+    env = getenv( "BGI_REPLAY" );
+    if ( env && !BGI__ReplayFile )
+    {
+        BGI__ReplayFile = fopen( env, "r" );
+        if ( BGI__ReplayFile == NULL )
+            showerrorbox( "Cannot open the BGI_REPLAY file" );
+        ReadReplayEvent( );
+    }
+    if ( BGI__ReplayFile )
+        pWndData->eventSource = ReplaySource;
+
+    graphdefaults( );
+    BGI__PumpEvents( );
+    return 0;
+}
+
+
+void closegraph( int wid )
+{
+    if ( wid == CURRENT_WINDOW || wid == ALL_WINDOWS || wid == 0 )
+    {
+        delete BGI__Window;
+        BGI__Window = NULL;
+    }
+}
+
+
+// This fuction detects the graphics driver and returns the highest resolution
+// mode possible.  This is always VGA/VGAHI
+//
+void detectgraph( int *graphdriver, int *graphmode )
+{
+    *graphdriver = VGA;
+    *graphmode = VGAHI;
+}
+
+
+void getaspectratio( int *xasp, int *yasp )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+    *xasp = pWndData->x_aspect_ratio;
+    *yasp = pWndData->y_aspect_ratio;
+}
+
+
+// This function will return the next character waiting to be read in the
+// window's keyboard buffer.  If there is none, the event source is asked
+// for everything it has; without any key there, 0 is returned rather than
+// waiting forever for input that cannot come.
+//
+int getch( )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+    bgievent event;
+    int c;
+    std::lock_guard<std::recursive_mutex> guard( pWndData->inputLock );
+
+    while ( pWndData->kbd_queue.empty( ) && pWndData->eventSource
+            && pWndData->eventSource( (unsigned)-1, &event ) )
+        postbgievent( event.kind, event.x, event.y );
+
+    if ( pWndData->kbd_queue.empty( ) )
+        return 0;
+
+    c = pWndData->kbd_queue.front( );
+    pWndData->kbd_queue.pop( );
+    return c;
+}
+
+
+char *getdrivername( )
+{
+    static char name[] = "EGAVGA";
+    return name;
+}
+
+
+int getgraphmode( )
+{
+    return VGAHI;
+}
+
+
+int getmaxmode( )
+{
+    return VGAHI;
+}
+
+
+char *getmodename( int mode_number )
+{
+    static char mode[32];
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+
+    snprintf( mode, sizeof( mode ), "%d*%d VGAHI", pWndData->width, pWndData->height );
+    return mode;
+}
+
+
+void getmoderange( int graphdriver, int *lomode, int *himode )
+{
+    if ( graphdriver == VGA || graphdriver == -1 )
+    {
+        *lomode = VGALO;
+        *himode = VGAHI;
+    }
+    else
+        *lomode = *himode = -1;
+}
+
+
+char *grapherrormsg( int errorcode )
+{
+    static const char *msg[16] = { "No error", "Graphics not installed",
+        "Graphics hardware not detected", "Device driver not found",
+        "Invalid device driver file", "Insufficient memory to load driver",
+        "Out of memory in scan fill", "Out of memory in flood fill",
+        "Font file not found", "Not enough meory to load font",
+        "Invalid mode for selected driver", "Graphics error",
+        "Graphics I/O error", "Invalid font file",
+        "Invalid font number", "Invalid device number" };
+
+    if ( ( errorcode < -15 ) || ( errorcode > 0 ) )
+        return NULL;
+    else
+        return (char*)msg[-errorcode];
+}
+
+
+int graphresult( )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+    int code;
+
+    code = pWndData->error_code;
+    pWndData->error_code = grOk;
+    return code;
+}
+
+
+// Every driver gets a VGAHI sized window here: there is no hardware to match.
+//
+void initgraph( int *graphdriver, int *graphmode, char *pathtodriver )
+{
+    detectgraph( graphdriver, graphmode );
+    initwindow( 640, 480 );
+}
+
+
+void restorecrtmode( )
+{ }
+
+
+int kbhit( )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+    std::lock_guard<std::recursive_mutex> guard( pWndData->inputLock );
+
+    return !pWndData->kbd_queue.empty( );
+}
+
+
+void setaspectratio( int xasp, int yasp )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+
+    pWndData->x_aspect_ratio = xasp;
+    pWndData->y_aspect_ratio = yasp;
+}
+
+
+void setgraphmode( int mode )
+{
+    graphdefaults( );
+    cleardevice( );
+}
+
+
+int getcurrentwindow( )
+{
+    return BGI__Window ? 0 : NO_CURRENT_WINDOW;
+}
+
+
+void setcurrentwindow( int window )
+{ }
+
+
+/*****************************************************************************
+*
+*   Double buffering support
+*
+*****************************************************************************/
+int getactivepage( )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+    return pWndData->ActivePage;
+}
+
+
+int getvisualpage( )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+    return pWndData->VisualPage;
+}
+
+
+void setactivepage( int page )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+
+    if ( (page < 0) || (page >= MAX_PAGES) )
+        return;
+
+    BGI__Flush( );
+    pWndData->ActivePage = page;
+}
+
+
+// Showing another page presents a frame, just like swapbuffers.
+//
+void setvisualpage( int page )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+
+    if ( (page < 0) || (page >= MAX_PAGES) )
+        return;
+
+    BGI__Flush( );
+    pWndData->VisualPage = page;
+    BGI__Present( );
+    pWndData->frame++;
+    DumpFrame( pWndData );
+    BGI__PumpEvents( );
+}
+
+
+void swapbuffers( )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+
+    BGI__Flush( );
+    if ( pWndData->ActivePage == 0 )
+    {
+        pWndData->VisualPage = 0;
+        pWndData->ActivePage = 1;
+    }
+    else    // Active page is 1
+    {
+        pWndData->VisualPage = 1;
+        pWndData->ActivePage = 0;
+    }
+    BGI__Present( );
+    pWndData->frame++;
+    DumpFrame( pWndData );
+    BGI__PumpEvents( );
+}
+
+
+/*****************************************************************************
+*
+*   Headless input and output
+*
+*****************************************************************************/
+// This function returns the number of frames presented so far.
+//
+unsigned getframecount( )
+{
+    return BGI__GetWindowDataPtr( )->frame;
+}
+
+
+// This function delivers an input event right away, as the window thread of
+// the GDI backend does with the messages it gets.
+//
+void postbgievent( int kind, int x, int y )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+    int type;
+    Handler handler;
+    std::lock_guard<std::recursive_mutex> guard( pWndData->inputLock );
+
+    if ( kind == BGI_KEY )
+        pWndData->kbd_queue.push( x );
+    else if ( kind == BGI_CLOSE )
+    {
+        if ( pWndData->CloseBehavior )
+            exit( 0 );
+    }
+    else if ( ( kind >= WM_MOUSEFIRST ) && ( kind <= WM_MOUSELAST ) )
+    {
+        MousePoint where = { x, y };
+
+        type = kind - WM_MOUSEFIRST;
+        if ( !(pWndData->mouse_queuing[type]) )
+            pWndData->clicks[type] = std::queue<MousePoint>( );
+        pWndData->clicks[type].push( where );
+        pWndData->mouse = where;
+
+        // If the user has registered a mouse handler, call it now
+        handler = pWndData->mouse_handlers[type];
+        if ( handler != NULL )
+            handler( x, y );
+    }
+}
+
+
+// This function replaces the source of input events (NULL for none).
+//
+void setbgieventsource( bgieventsource source )
+{
+    WindowData *pWndData = BGI__GetWindowDataPtr( );
+    std::lock_guard<std::recursive_mutex> guard( pWndData->inputLock );
+
+    pWndData->eventSource = source;
+}
+
+
+// This function sets the printf pattern of the PPM file written for every
+// frame, or stops writing them when pattern is NULL.
+//
+void setframedump( const char* pattern )
+{
+    BGI__GetWindowDataPtr( )->dumpPattern = pattern ? pattern : "";
+}
@@ -82,7 +82,7 @@ HDC BGI__GetWinbgiDC( HWND hWnd )
     // MGM: Added mutex to prevent conflict with OnPaint thread.
     // Anyone who calls BGI_GetWinbgiDC must later call
     // BGI_ReleaseWinbgiDC.
-    WaitForSingleObject(pWndData->hDCMutex, 5000);
+    BGI__LockDC( pWndData );
     // This is the device context we want to draw to
     return pWndData->hDC[pWndData->ActivePage];
 }
@@ -100,6 +100,45 @@ void BGI__ReleaseWinbgiDC( HWND hWnd )
     // MGM: Added mutex to prevent conflict with OnPaint thread.
     // Anyone who calls BGI_GetWinbgiDC must later call
     // BGI_ReleaseWinbgiDC.
+    BGI__UnlockDC( pWndData );
+}
+
+
+// This function takes hDCMutex for the drawing functions.  When the thread
+// holds it already (replaying recorded calls, say), it only goes one level
+// deeper.  Win32 mutexes are recursive anyway; the depth only saves the
+// system calls.  lockOwner is read by other threads while the owner sets it,
+// hence atomic; only the thread it names can find its own id there.  After a
+// timeout the thread owns nothing, so it draws unlocked as it always did, and
+// BGI__UnlockDC has nothing to release.
+//
+void BGI__LockDC( WindowData* pWndData )
+{
+    DWORD self = GetCurrentThreadId( );
+
+    if ( pWndData->lockOwner == self )
+    {
+        pWndData->lockDepth++;
+        return;
+    }
+
+    DWORD result = WaitForSingleObject(pWndData->hDCMutex, 5000);
+    if ( result != WAIT_OBJECT_0 && result != WAIT_ABANDONED )
+        return;
+    pWndData->lockDepth = 1;
+    pWndData->lockOwner = self;
+    pWndData->lockCount++;
+}
+
+
+void BGI__UnlockDC( WindowData* pWndData )
+{
+    if ( pWndData->lockOwner != GetCurrentThreadId( ) )
+        return;
+    if ( --pWndData->lockDepth > 0 )
+        return;
+
+    pWndData->lockOwner = 0;
     ReleaseMutex(pWndData->hDCMutex);
 }
 
@@ -140,36 +179,97 @@ void ArcEndPoints( int x, int y, int xradius, int yradius, int stangle,
     *yend    = -*yend + y;
 }
 
+// This function adds an area of the active page to its damage.  The
+// rectangles given to RefreshWindow leave out the width of the pen, so they
+// are widened by it.
+void BGI__AddDamage( const RECT* rect )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    RasterRect r = { 0, 0, pWndData->width, pWndData->height };
+    int pen = pWndData->lineInfo.thickness / 2 + 1;
+
+    if ( rect != NULL )
+    {
+        r.left = min( rect->left, rect->right ) - pen;
+        r.top = min( rect->top, rect->bottom ) - pen;
+        r.right = max( rect->left, rect->right ) + pen;
+        r.bottom = max( rect->top, rect->bottom ) + pen;
+    }
+    RasterDamageAdd( pWndData->damage[pWndData->ActivePage], r, pWndData->width, pWndData->height );
+
+    // Drawing on the visual page may change what is on the screen
+    if ( pWndData->ActivePage == pWndData->VisualPage )
+        RasterDamageAdd( pWndData->presented, r, pWndData->width, pWndData->height );
+}
+
+// This function invalidates what changes on the screen when the visual page
+// is shown.  The screen shows the page presented before on a background of
+// presentedColor, damaged where presented says, and the visual page is its
+// own clearColor outside of its damage.  When both colors agree the two
+// images can only differ in the union of both damages, so only that is
+// repainted instead of the whole window.
+void BGI__Present( )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    int page = pWndData->VisualPage;
+    RasterDamage damage;
+    RECT rect;
+
+    if ( pWndData->clearColor[page] < 0 || pWndData->clearColor[page] != pWndData->presentedColor )
+        InvalidateRect( pWndData->hWnd, NULL, FALSE );
+    else
+    {
+        RasterDamageClear( damage );
+        RasterDamageAdd( damage, pWndData->presented, pWndData->width, pWndData->height );
+        RasterDamageAdd( damage, pWndData->damage[page], pWndData->width, pWndData->height );
+        for ( int i = 0; i < damage.count; i++ )
+        {
+            SetRect( &rect, damage.rects[i].left, damage.rects[i].top,
+                     damage.rects[i].right, damage.rects[i].bottom );
+            InvalidateRect( pWndData->hWnd, &rect, FALSE );
+        }
+    }
+    pWndData->presented = pWndData->damage[page];
+    pWndData->presentedColor = pWndData->clearColor[page];
+}
+
+// This function returns the bounding box of n_points (x,y) pairs, with the
+// right and bottom edges included.
+RECT PointsBox( int n_points, const int* points )
+{
+    RECT rect = { 0, 0, 0, 0 };
+
+    for ( int i = 0; i < n_points; i++ )
+    {
+        if ( i == 0 || points[i*2] < rect.left )
+            rect.left = points[i*2];
+        if ( i == 0 || points[i*2] + 1 > rect.right )
+            rect.right = points[i*2] + 1;
+        if ( i == 0 || points[i*2 + 1] < rect.top )
+            rect.top = points[i*2 + 1];
+        if ( i == 0 || points[i*2 + 1] + 1 > rect.bottom )
+            rect.bottom = points[i*2 + 1] + 1;
+    }
+    return rect;
+}
+
 // This function will refresh the area of the window specified by rect.  If
 // want to update the entire screen, pass in NULL for rect.
 // POSTCONDITION: The parameter rect has been updated to now refer to
 //                device coordinates instead of logical coordinates.  Also,
 //                if we are refreshing, then the region specified by rect
-//                (in device coordinates) has been marked to repaint
+//                (in device coordinates) has been marked to repaint, and
+//                it has been added to the damage of the active page.
 void RefreshWindow( RECT* rect )
 {
-    HDC hDC;
     WindowData* pWndData = BGI__GetWindowDataPtr( );
-    POINT p[2];
 
+    // Convert from logical points (viewport relative) to device points.  The
+    // viewport origin is the only mapping set on the DCs, so this is done
+    // without LPtoDP, which would lock the DC a second time.
     if ( rect != NULL )
-    {
-        p[0].x = rect->left;
-        p[0].y = rect->top;
-        p[1].x = rect->right;
-        p[1].y = rect->bottom;
-
-        // Convert from the device points to logical points (viewport relative)
-	hDC = BGI__GetWinbgiDC( );
-        LPtoDP( hDC, p, 2 );
-        BGI__ReleaseWinbgiDC( );
-
-        // Copy back into the rectangle
-        rect->left = p[0].x;
-        rect->top = p[0].y;
-        rect->right = p[1].x;
-        rect->bottom = p[1].y;
-    }
+        OffsetRect( rect, pWndData->viewportInfo.left, pWndData->viewportInfo.top );
+    BGI__AddDamage( rect );
 
     if (pWndData->refreshing || rect == NULL)
     {
@@ -193,6 +293,7 @@ void setrefreshingbgi(bool value)
 
 void refreshallbgi( )
 {
+    BGI__Flush( );
     RefreshWindow(NULL);
 }
 
@@ -201,31 +302,95 @@ void refreshbgi(int left, int top, int right, int bottom)
     // The update rectangle does not contain the right or bottom edge.  Thus
     // add 1 so the entire region is included.
     RECT rect;
-    HDC hDC;
     WindowData* pWndData = BGI__GetWindowDataPtr( );
-    POINT p[2];
 
-    p[0].x = min(left, right);
-    p[0].y = min(top, bottom);
-    p[1].x = max(left, right);
-    p[1].y = max(top, bottom);
+    BGI__Flush( );
+    rect.left = min(left, right);
+    rect.top = min(top, bottom);
+    rect.right = max(left, right);
+    rect.bottom = max(top, bottom);
 
-    // Convert from the device points to logical points (viewport relative)
-    hDC = BGI__GetWinbgiDC( );
-    LPtoDP( hDC, p, 2 );
-    BGI__ReleaseWinbgiDC( );
-
-    // Copy into the rectangle
-    rect.left = p[0].x;
-    rect.top = p[0].y;
-    rect.right = p[1].x;
-    rect.bottom = p[1].y;
+    // Convert from logical points (viewport relative) to device points
+    OffsetRect( &rect, pWndData->viewportInfo.left, pWndData->viewportInfo.top );
 
     // Only invalidate the window if we are viewing what we are drawing.
     if ( pWndData->VisualPage == pWndData->ActivePage )
         InvalidateRect( pWndData->hWnd, &rect, FALSE );
 }
 
+// These two functions hold the DC lock from the start of a frame to its end.
+// The drawing functions in between find the lock already held by their own
+// thread, so they only count one level deeper instead of waiting on the
+// mutex for each call.  The paint thread has to wait until endframe.
+void beginframe( )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    if ( pWndData->inFrame )
+        return;
+    BGI__LockDC( pWndData );
+    pWndData->inFrame = true;
+}
+
+
+// What was recorded during the frame is drawn before the lock is given up.
+void endframe( )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    if ( !pWndData->inFrame )
+        return;
+    BGI__Flush( );
+    pWndData->inFrame = false;
+    BGI__UnlockDC( pWndData );
+}
+
+// This function returns the bits of the active page to draw into with the
+// Raster functions, clipped and translated like the DC.  The DC lock is held
+// until UnlockRasterPage, which also adds what was drawn to the damage.
+//
+static RasterPage LockRasterPage( )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    const viewporttype& vp = pWndData->viewportInfo;
+    RasterPage page;
+    HDC hDC;
+
+    hDC = BGI__GetWinbgiDC( );
+    // Let GDI finish pending drawing before touching the bits directly.
+    GdiFlush( );
+    page.pixels = (unsigned int*)pWndData->pPixels[pWndData->ActivePage];
+    page.width = pWndData->width;
+    page.height = pWndData->height;
+    page.xorg = vp.left;
+    page.yorg = vp.top;
+    page.left = vp.clip ? max( vp.left, 0 ) : 0;
+    page.top = vp.clip ? max( vp.top, 0 ) : 0;
+    page.right = vp.clip ? min( vp.right, pWndData->width ) : pWndData->width;
+    page.bottom = vp.clip ? min( vp.bottom, pWndData->height ) : pWndData->height;
+    page.xorMode = GetROP2( hDC ) == R2_XORPEN;
+    page.bounds = RasterEmptyRect( );
+    return page;
+}
+
+
+static void UnlockRasterPage( const RasterPage& page )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    BGI__ReleaseWinbgiDC( );
+
+    // The bounds are in device coordinates already
+    if ( page.bounds.right > page.bounds.left )
+    {
+        RECT rect = { page.bounds.left, page.bounds.top, page.bounds.right, page.bounds.bottom };
+        BGI__AddDamage( &rect );
+        if ( pWndData->refreshing && pWndData->VisualPage == pWndData->ActivePage )
+            InvalidateRect( pWndData->hWnd, &rect, FALSE );
+    }
+}
+
+
 /*****************************************************************************
 *
 *   The actual API calls are implemented below
@@ -253,6 +418,19 @@ void arc( int x, int y, int stangle, int endangle, int radius )
     // Convert given arc specifications to pixel start and end points.
     ArcEndPoints( x, y, radius, radius, stangle, endangle, &xstart, &ystart, &xend, &yend );
 
+    // Set the arccoords structure to relevant data, even if the arc is only
+    // recorded.
+    pWndData->arcInfo.x = x;
+    pWndData->arcInfo.y = y;
+    pWndData->arcInfo.xstart = xstart;
+    pWndData->arcInfo.ystart = ystart;
+    pWndData->arcInfo.xend = xend;
+    pWndData->arcInfo.yend = yend;
+
+    int args[] = { x, y, stangle, endangle, radius };
+    if ( BGI__Record( REC_ARC, args, 5 ) )
+        return;
+
     // Draw to the current active page
     hDC = BGI__GetWinbgiDC( );
     Arc( hDC, left, top, right, bottom, xstart, ystart, xend, yend );
@@ -262,14 +440,6 @@ void arc( int x, int y, int stangle, int endangle, int radius )
     // add 1 so the entire region is included.
     RECT rect = { left, top, right+1, bottom+1 };
     RefreshWindow( &rect );
-
-    // Set the arccoords structure to relevant data.
-    pWndData->arcInfo.x = x;
-    pWndData->arcInfo.y = y;
-    pWndData->arcInfo.xstart = xstart;
-    pWndData->arcInfo.ystart = ystart;
-    pWndData->arcInfo.xend = xend;
-    pWndData->arcInfo.yend = yend;
 }
 
 // This function draws a 2D bar.
@@ -281,6 +451,10 @@ void bar( int left, int top, int right, int bottom )
     HBRUSH hBrush;
     int color;
 
+    int args[] = { left, top, right, bottom };
+    if ( BGI__Record( REC_BAR, args, 4 ) )
+        return;
+
     hDC = BGI__GetWinbgiDC( );
     // Is it okay to use the currently selected brush to paint with?
     hBrush = (HBRUSH)GetCurrentObject( hDC, OBJ_BRUSH );
@@ -312,6 +486,10 @@ void bar3d( int left, int top, int right, int bottom, int depth, int topflag )
     int dy;     // Distance to draw 3D bar up to
     POINT p[4]; // An array to hold vertices for the outline
 
+    int args[] = { left, top, right, bottom, depth, topflag };
+    if ( BGI__Record( REC_BAR3D, args, 6 ) )
+        return;
+
     hDC = BGI__GetWinbgiDC( );
     // Set the text color for the fill pattern
     // Convert from BGI color to RGB color
@@ -369,6 +547,10 @@ void circle( int x, int y, int radius )
     WindowData* pWndData = BGI__GetWindowDataPtr( );
     int left, top, right, bottom;
 
+    int args[] = { x, y, radius };
+    if ( BGI__Record( REC_CIRCLE, args, 3 ) )
+        return;
+
     // Convert center coordinates to box coordinates
     CenterToBox( x, y, radius, radius, &left, &top, &right, &bottom );
 
@@ -385,7 +567,8 @@ void circle( int x, int y, int radius )
 
 
 // This function clears the graphics screen (with the background color) and
-// moves the current point to (0,0)
+// moves the current point to (0,0).  When the page was cleared with the same
+// color before, only what was drawn on it since is cleared.
 //
 void cleardevice( )
 {
@@ -397,6 +580,11 @@ void cleardevice( )
     int is_rgn;         // Whether or not a clipping region is present
     POINT p;            // Upper left point of window (convert from device to logical points)
     HBRUSH hBrush;      // Brush in the background color
+    int page = pWndData->ActivePage;
+    RasterDamage& damage = pWndData->damage[page];
+
+    if ( BGI__Record( REC_CLEARDEVICE, NULL, 0 ) )
+        return;
 
     // Convert from BGI color to RGB color
     color = converttorgb( pWndData->bgColor );
@@ -424,10 +612,21 @@ void cleardevice( )
     if ( is_rgn != 0 )
         SelectClipRgn( hDC, NULL );
 
-    // Fill hDC with background color
+    // Fill hDC with background color.  The damage is in device coordinates,
+    // which are offset by p from the logical ones.
     hBrush = CreateSolidBrush( color );
-    FillRect( hDC, &rect, hBrush );
+    if ( pWndData->clearColor[page] == color )
+        for ( int i = 0; i < damage.count; i++ )
+        {
+            SetRect( &rect, damage.rects[i].left + p.x, damage.rects[i].top + p.y,
+                     damage.rects[i].right + p.x, damage.rects[i].bottom + p.y );
+            FillRect( hDC, &rect, hBrush );
+        }
+    else
+        FillRect( hDC, &rect, hBrush );
     DeleteObject( hBrush );
+    RasterDamageClear( damage );
+    pWndData->clearColor[page] = color;
     // Move the CP back to (0,0) (NOT viewport relative)
     moveto( p.x, p.y );
 
@@ -438,7 +637,14 @@ void cleardevice( )
     DeleteRgn( hRGN );
     BGI__ReleaseWinbgiDC( );
 
-    RefreshWindow( NULL );
+    // The page has no damage now, so this does not go through RefreshWindow.
+    // When it is on the screen, all of the screen is repainted from it.
+    if ( pWndData->VisualPage == page )
+    {
+        RasterDamageClear( pWndData->presented );
+        pWndData->presentedColor = color;
+        InvalidateRect( pWndData->hWnd, NULL, FALSE );
+    }
 }
 
 
@@ -453,6 +659,9 @@ void clearviewport( )
     RECT rect;
     HBRUSH hBrush;
 
+    if ( BGI__Record( REC_CLEARVIEWPORT, NULL, 0 ) )
+        return;
+
     // Convert from BGI color to RGB color
     color = converttorgb( pWndData->bgColor );
 
@@ -478,13 +687,18 @@ void drawpoly(int n_points, int* points)
     HDC hDC;
     WindowData* pWndData = BGI__GetWindowDataPtr( );
 
+    int args[] = { n_points };
+    if ( BGI__Record( REC_DRAWPOLY, args, 1, points, n_points*2*sizeof(int) ) )
+        return;
+
     hDC = BGI__GetWinbgiDC();
     Polyline(hDC, (POINT*)points, n_points);
     BGI__ReleaseWinbgiDC( );
 
     // One could compute the convex hull of these points and create the
-    // associated region to update...
-    RefreshWindow( NULL );
+    // associated region to update, but the bounding box will do.
+    RECT rect = PointsBox( n_points, points );
+    RefreshWindow( &rect );
 }
 
 
@@ -502,6 +716,9 @@ void ellipse( int x, int y, int stangle, int endangle, int xradius, int yradius
     int left, top, right, bottom;
     int xstart, ystart, xend, yend;
 
+    int args[] = { x, y, stangle, endangle, xradius, yradius };
+    if ( BGI__Record( REC_ELLIPSE, args, 6 ) )
+        return;
 
     // Convert center coordinates to box coordinates
     CenterToBox( x, y, xradius, yradius, &left, &top, &right, &bottom );
@@ -532,6 +749,23 @@ void fillellipse( int x, int y, int xradius, int yradius )
     int left, top, right, bottom;
     int color;
 
+    int args[] = { x, y, xradius, yradius };
+    if ( BGI__Record( REC_FILLELLIPSE, args, 4 ) )
+        return;
+
+    // Solid ones, like explosions, are spans from the raster tables rather
+    // than GDI calls.
+    if ( pWndData->fillInfo.pattern == SOLID_FILL && pWndData->lineInfo.linestyle == SOLID_LINE )
+    {
+        RasterFill fill = { RasterColor( converttorgb( pWndData->fillInfo.color ) ), 0, NULL };
+        RasterPage page = LockRasterPage( );
+        RasterEllipse( page, x, y, xradius, yradius, fill );
+        RasterArc( page, x, y, 0, 360, xradius, yradius,
+                   RasterColor( converttorgb( pWndData->drawColor ) ), pWndData->lineInfo.thickness );
+        UnlockRasterPage( page );
+        return;
+    }
+
     // Convert center coordinates to box coordinates
     CenterToBox( x, y, xradius, yradius, &left, &top, &right, &bottom );
 
@@ -559,6 +793,25 @@ void fillpoly(int n_points, int* points)
     WindowData* pWndData = BGI__GetWindowDataPtr( );
     int color;
 
+    int args[] = { n_points };
+    if ( BGI__Record( REC_FILLPOLY, args, 1, points, n_points*2*sizeof(int) ) )
+        return;
+
+    // Solid ones, like the hulls of the game, are filled by walking their
+    // edges in the bits of the page and outlined there too, rather than by
+    // GDI calls.
+    if ( pWndData->fillInfo.pattern == SOLID_FILL && pWndData->lineInfo.linestyle == SOLID_LINE )
+    {
+        if ( n_points < 1 )
+            return;
+        RasterFill fill = { RasterColor( converttorgb( pWndData->fillInfo.color ) ), 0, NULL };
+        RasterPage page = LockRasterPage( );
+        RasterFillPoly( page, n_points, points, fill, RasterColor( converttorgb( pWndData->drawColor ) ),
+                        pWndData->lineInfo.thickness, 0xFFFF );
+        UnlockRasterPage( page );
+        return;
+    }
+
     // Set the text color for the fill pattern
     // Convert from BGI color to RGB color
     hDC = BGI__GetWinbgiDC();
@@ -572,7 +825,8 @@ void fillpoly(int n_points, int* points)
     SetTextColor( hDC, color );
     BGI__ReleaseWinbgiDC( );
 
-    RefreshWindow( NULL );
+    RECT rect = PointsBox( n_points, points );
+    RefreshWindow( &rect );
 }
 
 
@@ -587,6 +841,21 @@ void floodfill( int x, int y, int border )
     WindowData* pWndData = BGI__GetWindowDataPtr( );
     int color;
 
+    int args[] = { x, y, border };
+    if ( BGI__Record( REC_FLOODFILL, args, 3 ) )
+        return;
+
+    // A solid fill is filled span by span in the bits of the page, which is
+    // much faster than GDI reading it a pixel at a time.
+    if ( pWndData->fillInfo.pattern == SOLID_FILL )
+    {
+        RasterFill fill = { RasterColor( converttorgb( pWndData->fillInfo.color ) ), 0, NULL };
+        RasterPage page = LockRasterPage( );
+        RasterFloodFill( page, x, y, RasterColor( converttorgb( border ) ), fill );
+        UnlockRasterPage( page );
+        return;
+    }
+
     // Set the text color for the fill pattern
     // Convert from BGI color to RGB color
     color = converttorgb( pWndData->fillInfo.color );
@@ -614,6 +883,10 @@ void line( int x1, int y1, int x2, int y2 )
     // The current position
     POINT cp;
 
+    int args[] = { x1, y1, x2, y2 };
+    if ( BGI__Record( REC_LINE, args, 4 ) )
+        return;
+
     // Move to first point, save old point
     hDC = BGI__GetWinbgiDC( );
     MoveToEx( hDC, x1, y1, &cp );
@@ -643,6 +916,10 @@ void linerel( int dx, int dy )
     // The current position
     POINT cp;
 
+    int args[] = { dx, dy };
+    if ( BGI__Record( REC_LINEREL, args, 2 ) )
+        return;
+
     hDC = BGI__GetWinbgiDC( );
     GetCurrentPositionEx( hDC, &cp );
     LineTo( hDC, cp.x + dx, cp.y + dy );
@@ -666,6 +943,10 @@ void lineto( int x, int y )
     // The current position
     POINT cp;
 
+    int args[] = { x, y };
+    if ( BGI__Record( REC_LINETO, args, 2 ) )
+        return;
+
     hDC = BGI__GetWinbgiDC( );
     GetCurrentPositionEx( hDC, &cp );
     LineTo( hDC, x, y );
@@ -694,6 +975,9 @@ void pieslice( int x, int y, int stangle, int endangle, int radius )
     int xstart, ystart, xend, yend;
     int color;
 
+    int args[] = { x, y, stangle, endangle, radius };
+    if ( BGI__Record( REC_PIESLICE, args, 5 ) )
+        return;
 
     // Convert center coordinates to box coordinates
     CenterToBox( x, y, radius, radius, &left, &top, &right, &bottom );
@@ -724,6 +1008,10 @@ void putpixel( int x, int y, int color )
     HDC hDC;
     WindowData* pWndData = BGI__GetWindowDataPtr( );
 
+    int args[] = { x, y, color };
+    if ( BGI__Record( REC_PUTPIXEL, args, 3 ) )
+        return;
+
     color = converttorgb( color );
     // The call to SetPixelV might fail, but I don't know what to do if it does.
     hDC = BGI__GetWinbgiDC( );
@@ -737,6 +1025,29 @@ void putpixel( int x, int y, int color )
 }
 
 
+// This function plots count pixels at once.  The coordinates are given as
+// (x,y) pairs in xy, and colors[i] is the color of the i-th pixel.  The pixels
+// are written directly into the bits of the active page while the DC lock
+// is held once, rather than going through SetPixelV for every pixel, and are
+// clipped and XORed like the other raster drawing.
+//
+void putpixels( int count, const int* xy, const int* colors )
+{
+    if ( count < 1 )
+        return;
+
+    int args[] = { count };
+    if ( BGI__Record( REC_PUTPIXELS, args, 1,
+                      xy, count*2*sizeof(int), colors, count*sizeof(int) ) )
+        return;
+
+    RasterPage page = LockRasterPage( );
+    for ( int i = 0; i < count; i++ )
+        RasterPixel( page, xy[i*2], xy[i*2 + 1], RasterColor( converttorgb( colors[i] ) ) );
+    UnlockRasterPage( page );
+}
+
+
 // This function draws a rectangle border in the current line style, thickness, and color
 //
 void rectangle( int left, int top, int right, int bottom )
@@ -756,6 +1067,10 @@ void rectangle( int left, int top, int right, int bottom )
     endpoints[4].x = left;      // Upper left to complete rectangle
     endpoints[4].y = top;
 
+    int args[] = { left, top, right, bottom };
+    if ( BGI__Record( REC_RECTANGLE, args, 4 ) )
+        return;
+
     hDC = BGI__GetWinbgiDC( );
     Polyline( hDC, endpoints, 5 );
     BGI__ReleaseWinbgiDC( );
@@ -783,6 +1098,9 @@ void sector( int x, int y, int stangle, int endangle, int xradius, int yradius )
     int xstart, ystart, xend, yend;
     int color;
 
+    int args[] = { x, y, stangle, endangle, xradius, yradius };
+    if ( BGI__Record( REC_SECTOR, args, 6 ) )
+        return;
 
     // Convert center coordinates to box coordinates
     CenterToBox( x, y, xradius, yradius, &left, &top, &right, &bottom );
@@ -806,6 +1124,25 @@ void sector( int x, int y, int stangle, int endangle, int xradius, int yradius )
     RefreshWindow( &rect );
 }
 
+
+// This function draws a line of the given thickness with round ends in the
+// drawing color.  Like putpixels, it is rasterized straight into the bits of
+// the active page, so the thickness needs no new pen and the line style is
+// left alone.
+//
+void thickline( int x1, int y1, int x2, int y2, int thickness )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    int args[] = { x1, y1, x2, y2, thickness };
+    if ( BGI__Record( REC_THICKLINE, args, 5 ) )
+        return;
+
+    RasterPage page = LockRasterPage( );
+    RasterCapsule( page, x1, y1, x2, y2, thickness, RasterColor( converttorgb( pWndData->drawColor ) ) );
+    UnlockRasterPage( page );
+}
+
 // MGM modified imagesize so that it returns zero in the case of failure.
 unsigned int imagesize(int left, int top, int right, int bottom)
 {
@@ -823,6 +1160,7 @@ unsigned int imagesize(int left, int top, int right, int bottom)
     width = 1 + abs(right - left);
     height = 1 + abs(bottom - top);
     pWndData = BGI__GetWindowDataPtr( );
+    BGI__Flush( );
     hDC = BGI__GetWinbgiDC( );
 
     // Create the memory DC and select a new larger bitmap for it, saving the
@@ -861,6 +1199,7 @@ void getimage(int left, int top, int right, int bottom, void *bitmap)
 
     // Preliminary computations
     pWndData = BGI__GetWindowDataPtr( );
+    BGI__Flush( );
     hDC = BGI__GetWinbgiDC( );
     width = 1 + abs(right - left);
     height = 1 + abs(bottom - top);
@@ -903,6 +1242,13 @@ void putimage( int left, int top, void *bitmap, int op )
     width = pUser->bmWidth;
     height = pUser->bmHeight;
     pWndData = BGI__GetWindowDataPtr( );
+
+    // The image is copied, as the user may change it before it is replayed
+    int args[] = { left, top, op };
+    if ( BGI__Record( REC_PUTIMAGE, args, 3,
+                      bitmap, sizeof(BITMAP) + pUser->bmHeight*pUser->bmWidthBytes ) )
+        return;
+
     hDC = BGI__GetWinbgiDC( );
 
     // Create the memory DC and select a new larger bitmap for it, saving the
@@ -1069,6 +1415,7 @@ void readimagefile(
     if (pPicture)
     {
 	pWndData = BGI__GetWindowDataPtr( );
+	BGI__Flush( );
 	hDC = BGI__GetWinbgiDC( );
 	width = 1 + abs(right - left);
 	height = 1 + abs(bottom - top);
@@ -1113,7 +1460,8 @@ void writeimagefile(
 
     // Preliminary computations
     pWndData = BGI__GetWindowDataPtr(hwnd);
-    WaitForSingleObject(pWndData->hDCMutex, 5000);
+    BGI__Flush( );
+    BGI__LockDC( pWndData );
     if (active)
 	hDC = pWndData->hDC[pWndData->ActivePage];
     else
@@ -1148,7 +1496,7 @@ void writeimagefile(
 	SaveDIB(hDIB, filename);
 
     // Delete resources
-    ReleaseMutex(pWndData->hDCMutex);
+    BGI__UnlockDC( pWndData );
     DestroyDIB(hDIB);
     SelectObject(hMemoryDC, hOldBitmap); // Restore original bmp so it's deleted
     DeleteObject(hBitmap);               // Delete the bitmap we used
@@ -1196,7 +1544,8 @@ void printimage(
 
     // Get the window's hDC, width and height
     pWndData = BGI__GetWindowDataPtr(hwnd);
-    WaitForSingleObject(pWndData->hDCMutex, 5000);
+    BGI__Flush( );
+    BGI__LockDC( pWndData );
     if (active)
 	hDC = pWndData->hDC[pWndData->ActivePage];
     else
@@ -1260,7 +1609,7 @@ void printimage(
     }
 
     // Delete the resources
-    ReleaseMutex(pWndData->hDCMutex);
+    BGI__UnlockDC( pWndData );
     SelectObject(hMemoryDC, hOldBitmap); // Restore original bmp so it's deleted
     DeleteObject(hBitmap);               // Delete the bitmap we used
     DeleteDC(hMemoryDC);                 // Delete the memory dc and it's bmp
@@ -12,8 +12,10 @@
 
 #include <windows.h>        // Provides Win32 API
 #include <windowsx.h>       // Provides GDI helper macros
+#include <algorithm>        // Provides std::find
 #include "winbgim.h"         // API routines
 #include "winbgitypes.h"    // Internal structure data
+#include "pacer.h"          // Provides PacerDelay
 
 
 
@@ -116,46 +118,83 @@ int converttorgb( int color )
     return color;
 }
 
-#include <iostream>
-// This function creates a new pen in the current drawing color and selects it
-// into all the memory DC's.
+// This function returns the pen for the current drawing color and line
+// style.  Pens are kept in a cache, most recently used last, so switching
+// back to a color or style used lately only finds its pen.  Once MAX_PENS are
+// kept, the least recently used one that no DC has selected makes room.
 //
-void CreateNewPen( )
+static HPEN FindPen( WindowData* pWndData )
 {
-    WindowData* pWndData = BGI__GetWindowDataPtr( );
-    int color = pWndData->drawColor;;
+    std::vector<CachedPen>& pens = pWndData->pens;
+    CachedPen key;
     LinePattern style;
     LOGBRUSH lb;
-    HPEN hPen;
 
     // Convert from BGI color to RGB color
-    color = converttorgb( color );
+    key.color = converttorgb( pWndData->drawColor );
+    key.linestyle = pWndData->lineInfo.linestyle;
+    key.upattern = key.linestyle == USERBIT_LINE ? pWndData->lineInfo.upattern & 0xFFFF : 0;
+    key.thickness = pWndData->lineInfo.thickness;
+
+    for ( size_t i = pens.size( ); i-- > 0; )
+        if ( pens[i].color == key.color && pens[i].linestyle == key.linestyle &&
+             pens[i].upattern == key.upattern && pens[i].thickness == key.thickness )
+        {
+            key = pens[i];
+            pens.erase( pens.begin( ) + i );
+            pens.push_back( key );
+            return key.hPen;
+        }
+
+    if ( pens.size( ) >= MAX_PENS )
+        for ( size_t i = 0; i < pens.size( ); i++ )
+            if ( std::find( pWndData->hPen, pWndData->hPen + MAX_PAGES, pens[i].hPen ) == pWndData->hPen + MAX_PAGES )
+            {
+                DeletePen( pens[i].hPen );
+                pens.erase( pens.begin( ) + i );
+                break;
+            }
 
     // Set the color and style of the logical brush
-    lb.lbColor = color;
+    lb.lbColor = key.color;
     lb.lbStyle = BS_SOLID;
 
-    if ( pWndData->lineInfo.linestyle == SOLID_LINE )   style = SOLID;
-    if ( pWndData->lineInfo.linestyle == DOTTED_LINE )  style = DOTTED;
-    if ( pWndData->lineInfo.linestyle == CENTER_LINE )  style = CENTER;
-    if ( pWndData->lineInfo.linestyle == DASHED_LINE )  style = DASHED;
+    if ( key.linestyle == SOLID_LINE )   style = SOLID;
+    if ( key.linestyle == DOTTED_LINE )  style = DOTTED;
+    if ( key.linestyle == CENTER_LINE )  style = CENTER;
+    if ( key.linestyle == DASHED_LINE )  style = DASHED;
     // TODO: If user specifies a 0 pattern, create a NULL pen.
-    if ( pWndData->lineInfo.linestyle == USERBIT_LINE ) style = CreateUserStyle( );
+    if ( key.linestyle == USERBIT_LINE ) style = CreateUserStyle( );
 
     // Round endcaps are default, set to square
     // Use a bevel join
-    WaitForSingleObject(pWndData->hDCMutex, 5000);
-    for ( int i = 0; i < MAX_PAGES; i++ )
-    {
-        hPen = ExtCreatePen( PS_GEOMETRIC | PS_ENDCAP_SQUARE
+    key.hPen = ExtCreatePen( PS_GEOMETRIC | PS_ENDCAP_SQUARE
                               | PS_JOIN_BEVEL | PS_USERSTYLE,   // Pen Style
-                             pWndData->lineInfo.thickness,      // Pen Width
+                             key.thickness,                     // Pen Width
                              &lb,                               // Logical Brush
                              style.width,                       // Bytes in pattern
                              style.pattern );                   // Line Pattern
-        DeletePen( (HPEN)SelectObject( pWndData->hDC[i], hPen ) );
-    }
-    ReleaseMutex(pWndData->hDCMutex);
+    pens.push_back( key );
+    return key.hPen;
+}
+
+
+// This function selects the pen for the current drawing color and line style
+// into all the memory DC's.  A DC that has it selected already is left alone.
+//
+void CreateNewPen( )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    HPEN hPen = FindPen( pWndData );
+
+    BGI__LockDC( pWndData );
+    for ( int i = 0; i < MAX_PAGES; i++ )
+        if ( pWndData->hPen[i] != hPen )
+        {
+            SelectPen( pWndData->hDC[i], hPen );
+            pWndData->hPen[i] = hPen;
+        }
+    BGI__UnlockDC( pWndData );
 }
 
 
@@ -250,22 +289,11 @@ LinePattern CreateUserStyle( )
 *****************************************************************************/
 
 // This function will pause the current thread for the specified number of
-// milliseconds
+// milliseconds, sleeping most of it (pacer.cxx)
 //
 void delay( int msec )
 {
-    LARGE_INTEGER StartingTime, EndingTime;
-    LARGE_INTEGER Frequency;
-
-    QueryPerformanceFrequency(&Frequency);
-
-    QueryPerformanceCounter(&StartingTime);
-
-    do
-        QueryPerformanceCounter(&EndingTime);
-    while(msec > (EndingTime.QuadPart - StartingTime.QuadPart) * 1000 / Frequency.QuadPart);
-
-    //Sleep( msec );
+    PacerDelay( msec );
 }
 
 
@@ -423,6 +451,7 @@ int getdisplaycolor( int color )
 
 int getpixel( int x, int y )
 {
+    BGI__Flush( );
     HDC hDC = BGI__GetWinbgiDC( );
     COLORREF color = GetPixel( hDC, x, y );
     BGI__ReleaseWinbgiDC( );
@@ -457,6 +486,7 @@ void getviewsettings( viewporttype *viewport )
 //
 int getx( )
 {
+    BGI__Flush( );
     HDC hDC = BGI__GetWinbgiDC( );
     POINT cp;
 
@@ -470,6 +500,7 @@ int getx( )
 //
 int gety( )
 {
+    BGI__Flush( );
     HDC hDC = BGI__GetWinbgiDC( );
     POINT cp;
 
@@ -484,6 +515,10 @@ int gety( )
 //
 void moverel( int dx, int dy )
 {
+    int args[] = { dx, dy };
+    if ( BGI__Record( REC_MOVEREL, args, 2 ) )
+        return;
+
     HDC hDC = BGI__GetWinbgiDC( );
     POINT cp;
 
@@ -499,6 +534,10 @@ void moverel( int dx, int dy )
 //
 void moveto( int x, int y )
 {
+    int args[] = { x, y };
+    if ( BGI__Record( REC_MOVETO, args, 2 ) )
+        return;
+
     HDC hDC = BGI__GetWinbgiDC( );
 
     MoveToEx( hDC, x, y, NULL );
@@ -512,13 +551,17 @@ void setbkcolor( int color )
 
     pWndData->bgColor = color;
 
+    int args[] = { color };
+    if ( BGI__Record( REC_SETBKCOLOR, args, 1 ) )
+        return;
+
     // Convert from BGI color to RGB color
     color = converttorgb( color );
 
-    WaitForSingleObject(pWndData->hDCMutex, 5000);
+    BGI__LockDC( pWndData );
     for ( int i = 0; i < MAX_PAGES; i++ )
         SetBkColor( pWndData->hDC[i], color );
-    ReleaseMutex(pWndData->hDCMutex);
+    BGI__UnlockDC( pWndData );
 }
 
 
@@ -529,14 +572,18 @@ void setcolor( int color )
     // Update the color in our structure
     pWndData->drawColor = color;
 
+    int args[] = { color };
+    if ( BGI__Record( REC_SETCOLOR, args, 1 ) )
+        return;
+
     // Convert from BGI color to RGB color
     color = converttorgb( color );
 
     // Use that to set the text color for each page
-    WaitForSingleObject(pWndData->hDCMutex, 5000);
+    BGI__LockDC( pWndData );
     for ( int i = 0; i < MAX_PAGES; i++ )
         SetTextColor( pWndData->hDC[i], color );
-    ReleaseMutex(pWndData->hDCMutex);
+    BGI__UnlockDC( pWndData );
 
     // Create the new drawing pen
     CreateNewPen( );
@@ -550,74 +597,33 @@ void setlinestyle( int linestyle, unsigned upattern, int thickness )
     pWndData->lineInfo.upattern = upattern;
     pWndData->lineInfo.thickness = thickness;
 
+    int args[] = { linestyle, (int)upattern, thickness };
+    if ( BGI__Record( REC_SETLINESTYLE, args, 3 ) )
+        return;
+
     // Create the new drawing pen
     CreateNewPen( );
 }
 
 
-// The user calls this function to create a brush with a pattern they create
+// This function creates the brush for a fill style.  color is the RGB color
+// of the style, and upattern the pattern bytes for USER_FILL.
 //
-void setfillpattern( char *upattern, int color )
+static HBRUSH CreateFillBrush( int pattern, COLORREF color, const char* upattern )
 {
-    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    HBRUSH hBrush = NULL;
     HBITMAP hBitmap;
-    HBRUSH hBrush;
-    unsigned short pattern[8];
-    int i;
-
-    // Copy the pattern to the storage for the window
-    memcpy( pWndData->uPattern, upattern, sizeof( pWndData->uPattern ) );
-
-    // Convert the pattern to create a brush
-    for ( i = 0; i < 8; i++ )
-        pattern[i] = (unsigned char)~upattern[i];       // Restrict to 8 bits
-
-    // Set the settings for the structure
-    pWndData->fillInfo.pattern = USER_FILL;
-    pWndData->fillInfo.color = color;
-
-    // Create the bitmap
-    hBitmap = CreateBitmap( 8, 8, 1, 1, pattern );
-    // Create a brush for each DC
-    WaitForSingleObject(pWndData->hDCMutex, 5000);
-    for ( int i = 0; i < MAX_PAGES; i++ )
-    {
-        hBrush = CreatePatternBrush( hBitmap );
-        // Select the new brush into the device context and delete the old one.
-        DeleteBrush( (HBRUSH)SelectBrush( pWndData->hDC[i], hBrush ) );
-    }
-    ReleaseMutex(pWndData->hDCMutex);
-    // I'm not sure if it's safe to delete the bitmap here or not, but it
-    // hasn't caused any problems.  The material I've found just says the
-    // bitmap must be deleted in addition to the brush when finished.
-    DeleteBitmap( hBitmap );
-
-}
-
-
-// If the USER_FILL pattern is passed, nothing is changed.
-//
-void setfillstyle( int pattern, int color )
-{
-    WindowData* pWndData = BGI__GetWindowDataPtr( );
-    HDC hDC = BGI__GetWinbgiDC( );
-    HBRUSH hBrush;
     // Unsigned char creates a truncation for some reason.
     /*unsigned*/ short Slash[8]      = { ~0xE0, ~0xC1, ~0x83, ~0x07, ~0x0E, ~0x1C, ~0x38, ~0x70 };
     /*unsigned*/ short BkSlash[8]    = { ~0x07, ~0x83, ~0xC1, ~0xE0, ~0x70, ~0x38, ~0x1C, ~0x0E };
     /*unsigned*/ short Interleave[8] = { ~0xCC, ~0x33, ~0xCC, ~0x33, ~0xCC, ~0x33, ~0xCC, ~0x33 };
     /*unsigned*/ short WideDot[8]    = { ~0x80, ~0x00, ~0x08, ~0x00, ~0x80, ~0x00, ~0x08, ~0x00 };
     /*unsigned*/ short CloseDot[8]   = { ~0x88, ~0x00, ~0x22, ~0x00, ~0x88, ~0x00, ~0x22, ~0x00 };
-    HBITMAP hBitmap;
-
-    // Convert from BGI color to RGB color
-    color = converttorgb( color );
+    unsigned short user[8];
 
     switch ( pattern )
     {
     case EMPTY_FILL:
-        hBrush = CreateSolidBrush( converttorgb( pWndData->bgColor ));
-        break;
     case SOLID_FILL:
         hBrush = CreateSolidBrush( color );
         break;
@@ -667,20 +673,139 @@ void setfillstyle( int pattern, int color )
         DeleteBitmap( hBitmap );
         break;
     case USER_FILL:
-        return;
+        // Convert the pattern to create a brush
+        for ( int i = 0; i < 8; i++ )
+            user[i] = (unsigned char)~upattern[i];      // Restrict to 8 bits
+        // I'm not sure if it's safe to delete the bitmap here or not, but it
+        // hasn't caused any problems.  The material I've found just says the
+        // bitmap must be deleted in addition to the brush when finished.
+        hBitmap = CreateBitmap( 8, 8, 1, 1, user );
+        hBrush = CreatePatternBrush( hBitmap );
+        DeleteBitmap( hBitmap );
         break;
-    default:
+    }
+    return hBrush;
+}
+
+
+// This function returns the brush for a fill style, from the brush cache
+// that works like the pen cache of FindPen.  The color is only part of the
+// key for the styles whose brush is made with it.
+//
+static HBRUSH FindBrush( WindowData* pWndData, int pattern, COLORREF color, const char* upattern )
+{
+    std::vector<CachedBrush>& brushes = pWndData->brushes;
+    CachedBrush key;
+
+    key.pattern = pattern;
+    key.color = color;
+    memset( key.uPattern, 0, sizeof( key.uPattern ) );
+    if ( pattern == USER_FILL )
+        memcpy( key.uPattern, upattern, sizeof( key.uPattern ) );
+    if ( pattern == SLASH_FILL || pattern == BKSLASH_FILL || pattern == INTERLEAVE_FILL ||
+         pattern == WIDE_DOT_FILL || pattern == CLOSE_DOT_FILL || pattern == USER_FILL )
+        key.color = 0;
+
+    for ( size_t i = brushes.size( ); i-- > 0; )
+        if ( brushes[i].pattern == key.pattern && brushes[i].color == key.color &&
+             memcmp( brushes[i].uPattern, key.uPattern, sizeof( key.uPattern ) ) == 0 )
+        {
+            key = brushes[i];
+            brushes.erase( brushes.begin( ) + i );
+            brushes.push_back( key );
+            return key.hBrush;
+        }
+
+    if ( brushes.size( ) >= MAX_BRUSHES )
+        for ( size_t i = 0; i < brushes.size( ); i++ )
+            if ( std::find( pWndData->hBrush, pWndData->hBrush + MAX_PAGES, brushes[i].hBrush ) == pWndData->hBrush + MAX_PAGES )
+            {
+                DeleteBrush( brushes[i].hBrush );
+                brushes.erase( brushes.begin( ) + i );
+                break;
+            }
+
+    key.hBrush = CreateFillBrush( key.pattern, key.color, key.uPattern );
+    brushes.push_back( key );
+    return key.hBrush;
+}
+
+
+// This function selects a brush into the DC of a page, unless it has it
+// selected already.
+//
+static void SelectCachedBrush( WindowData* pWndData, int page, HBRUSH hBrush )
+{
+    if ( pWndData->hBrush[page] != hBrush )
+    {
+        SelectBrush( pWndData->hDC[page], hBrush );
+        pWndData->hBrush[page] = hBrush;
+    }
+}
+
+
+// The user calls this function to create a brush with a pattern they create
+//
+void setfillpattern( char *upattern, int color )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    HBRUSH hBrush;
+
+    // Copy the pattern to the storage for the window
+    memcpy( pWndData->uPattern, upattern, sizeof( pWndData->uPattern ) );
+    pWndData->fillInfo.pattern = USER_FILL;
+    pWndData->fillInfo.color = color;
+
+    int args[] = { color };
+    if ( BGI__Record( REC_SETFILLPATTERN, args, 1, upattern, sizeof( pWndData->uPattern ) ) )
+        return;
+
+    // Select the brush into each DC
+    hBrush = FindBrush( pWndData, USER_FILL, 0, upattern );
+    BGI__LockDC( pWndData );
+    for ( int i = 0; i < MAX_PAGES; i++ )
+        SelectCachedBrush( pWndData, i, hBrush );
+    BGI__UnlockDC( pWndData );
+}
+
+
+// If the USER_FILL pattern is passed, nothing is changed.
+//
+void setfillstyle( int pattern, int color )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    HBRUSH hBrush;
+
+    if ( pattern == USER_FILL )
+        return;
+    if ( pattern < EMPTY_FILL || pattern > CLOSE_DOT_FILL )
+    {
         pWndData->error_code = grError;
         return;
     }
 
+    int args[] = { pattern, color };
+
+    // Convert from BGI color to RGB color
+    color = converttorgb( color );
+
     // TODO: Modify this so the brush is created in every DC
     pWndData->fillInfo.pattern = pattern;
     pWndData->fillInfo.color = color;
 
-    // Select the new brush into the device context and delete the old one.
-    DeleteBrush( (HBRUSH)SelectBrush( hDC, hBrush ) );
-    BGI__ReleaseWinbgiDC( );
+    if ( BGI__Record( REC_SETFILLSTYLE, args, 2 ) )
+        return;
+
+    // An empty fill paints with the background color
+    if ( pattern == EMPTY_FILL )
+        hBrush = FindBrush( pWndData, pattern, converttorgb( pWndData->bgColor ), NULL );
+    else
+        hBrush = FindBrush( pWndData, pattern, color, NULL );
+
+    // Select the brush into the device context of the active page
+    BGI__LockDC( pWndData );
+    SelectCachedBrush( pWndData, pWndData->ActivePage, hBrush );
+    BGI__UnlockDC( pWndData );
 }
 
 
@@ -696,12 +821,16 @@ void setviewport( int left, int top, int right, int bottom, int clip )
     pWndData->viewportInfo.bottom = bottom;
     pWndData->viewportInfo.clip = clip;
 
+    int args[] = { left, top, right, bottom, clip };
+    if ( BGI__Record( REC_SETVIEWPORT, args, 5 ) )
+        return;
+
     // If the drwaing should be clipped at the viewport boundary, create a
     // clipping region
     if ( clip != 0 )
         hRGN = CreateRectRgn( left, top, right, bottom );
 
-    WaitForSingleObject(pWndData->hDCMutex, 5000);
+    BGI__LockDC( pWndData );
     for ( int i = 0; i < MAX_PAGES; i++ )
     {
         SelectClipRgn( pWndData->hDC[i], hRGN );
@@ -712,7 +841,7 @@ void setviewport( int left, int top, int right, int bottom, int clip )
         // Move to the new origin
         MoveToEx( pWndData->hDC[i], 0, 0, NULL );
     }
-    ReleaseMutex(pWndData->hDCMutex);
+    BGI__UnlockDC( pWndData );
     // A copy of the region is used for the clipping region, so it is
     // safe to delete the region  (p. 369 Win32 API book)
     DeleteRgn( hRGN );
@@ -721,6 +850,10 @@ void setviewport( int left, int top, int right, int bottom, int clip )
 
 void setwritemode( int mode )
 {
+    int args[] = { mode };
+    if ( BGI__Record( REC_SETWRITEMODE, args, 1 ) )
+        return;
+
     HDC hDC = BGI__GetWinbgiDC( );
 
     if ( mode == COPY_PUT )
@@ -0,0 +1,132 @@
+// File: pacer.cxx
+//
+// Portable waiting for delay.  This file uses nothing but the standard
+// library (and the process times on Windows, where clock counts wall time),
+// so that it can be shared by the GDI backend and the software one.
+//
+
+#include <stdlib.h>         // Provides getenv
+#include <time.h>           // Provides clock
+#include <algorithm>        // Provides std::max
+#include <chrono>           // Provides std::chrono::steady_clock
+#include <iostream>         // Provides std::cerr
+#include <thread>           // Provides std::this_thread
+#ifdef _WIN32
+#define NOMINMAX            // Keep windows.h from hiding std::max
+#include <windows.h>        // Provides GetProcessTimes
+#endif
+#include "pacer.h"          // Declarations of this file
+
+typedef std::chrono::steady_clock PacerClock;
+typedef std::chrono::microseconds PacerMicros;
+
+// A sleep is asked to end this many microseconds before the deadline, or
+// more when the OS timer is coarser: the margin grows to the largest oversleep
+// seen lately, and decays back by 1/16 at every wait, so that it is probed
+// again even once it got too large to sleep at all.
+#define PACER_MARGIN 1000
+
+
+/*****************************************************************************
+*
+*   Statistics
+*
+*****************************************************************************/
+// What the waits since start did.  late is how long after its deadline a
+// wait returned, in microseconds.
+struct PacerStats
+{
+    bool on;                    // BGI_PACESTATS is set
+    PacerClock::time_point start;
+    double cpuStart;            // CPU seconds used by the process at start
+    int waits;
+    long long lateSum, lateMax;
+};
+
+static long long pacer_margin = PACER_MARGIN;
+static PacerStats pacer_stats;
+
+
+/*****************************************************************************
+*
+*   Helper functions
+*
+*****************************************************************************/
+// This function returns the CPU time the process used so far, all threads
+// included, in seconds.
+//
+static double PacerCpuTime( )
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+
+    GetProcessTimes( GetCurrentProcess( ), &creation, &exit, &kernel, &user );
+    ULONGLONG ticks = ( (ULONGLONG)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime ) +
+                      ( (ULONGLONG)user.dwHighDateTime << 32 | user.dwLowDateTime );
+    return ticks / 1e7;
+#else
+    return (double)clock( ) / CLOCKS_PER_SEC;
+#endif
+}
+
+
+// This function counts a wait that returned late microseconds after its
+// deadline, and prints the statistics once they cover a second.
+//
+static void PacerCount( PacerClock::time_point now, long long late )
+{
+    static bool checked = false;
+
+    if ( !checked )
+    {
+        checked = true;
+        pacer_stats.on = getenv( "BGI_PACESTATS" ) != NULL;
+        pacer_stats.start = now;
+        pacer_stats.cpuStart = PacerCpuTime( );
+    }
+    if ( !pacer_stats.on )
+        return;
+
+    pacer_stats.waits++;
+    pacer_stats.lateSum += late;
+    pacer_stats.lateMax = std::max( pacer_stats.lateMax, late );
+
+    double wall = std::chrono::duration<double>( now - pacer_stats.start ).count( );
+    if ( wall < 1.0 )
+        return;
+    double cpu = PacerCpuTime( );
+    std::cerr << "winbgi: " << pacer_stats.waits << " delays, late by "
+              << pacer_stats.lateSum / pacer_stats.waits << " us on average, "
+              << pacer_stats.lateMax << " us at most, "
+              << (int)( 100.0 * ( cpu - pacer_stats.cpuStart ) / wall + 0.5 ) << "% CPU" << std::endl;
+    pacer_stats.start = now;
+    pacer_stats.cpuStart = cpu;
+    pacer_stats.waits = 0;
+    pacer_stats.lateSum = pacer_stats.lateMax = 0;
+}
+
+
+/*****************************************************************************
+*
+*   The actual API calls are implemented below
+*
+*****************************************************************************/
+void PacerDelay( int msec )
+{
+    PacerClock::time_point deadline = PacerClock::now( ) + std::chrono::milliseconds( msec );
+    PacerClock::time_point wake = deadline - PacerMicros( pacer_margin );
+
+    pacer_margin = std::max( pacer_margin - pacer_margin/16, (long long)PACER_MARGIN );
+    if ( PacerClock::now( ) < wake )
+    {
+        std::this_thread::sleep_until( wake );
+        long long over = std::chrono::duration_cast<PacerMicros>( PacerClock::now( ) - wake ).count( );
+        pacer_margin = std::max( pacer_margin, over );
+    }
+
+    PacerClock::time_point now;
+    while ( (now = PacerClock::now( )) < deadline )
+        std::this_thread::yield( );
+
+    PacerCount( now, std::chrono::duration_cast<PacerMicros>( now - deadline ).count( ) );
+}
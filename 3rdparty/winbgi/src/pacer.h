@@ -0,0 +1,20 @@
+// File: pacer.h
+//
+// Portable waiting for delay, shared by the GDI backend and the software one.
+// Sleeping alone wakes up as late as the OS timer allows, and spinning alone
+// keeps a core busy the whole time, so a wait sleeps until about a millisecond
+// before its end and spins the rest.
+//
+
+#ifndef PACER_H
+#define PACER_H
+
+// ---------------------------------------------------------------------------
+//                              Prototypes
+// ---------------------------------------------------------------------------
+// Waits msec milliseconds.  When BGI_PACESTATS is set, prints every second how
+// late the waits ended on average and at worst, and the share of a core the
+// process used meanwhile.
+void PacerDelay( int msec );
+
+#endif  // PACER_H
@@ -0,0 +1,852 @@
+// File: raster.cxx
+//
+// Portable rasterization of the BGI primitives into a plain 32-bit page.
+// This file uses nothing but the standard library, so that it can be shared
+// by the GDI backend (drawing into the DIB sections) and the software one.
+//
+
+#define _USE_MATH_DEFINES   // Actually use the definitions in math.h
+#include <math.h>           // For mathematical functions
+#include <stdlib.h>         // Provides abs
+#include <string.h>         // Provides memset
+#include <algorithm>        // Provides std::sort, std::fill_n, std::min, std::max
+#include <vector>           // Provides std::vector
+#include "raster.h"         // Declarations of this file
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+
+/*****************************************************************************
+*
+*   Patterns
+*
+*****************************************************************************/
+// The standard BGI fill patterns, one byte per row, most significant bit
+// leftmost.  SOLID_FILL has no pattern since it takes the fast path.
+static const unsigned char fill_patterns[][8] =
+{
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // EMPTY_FILL
+    { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },  // SOLID_FILL
+    { 0xFF, 0xFF, 0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00 },  // LINE_FILL
+    { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 },  // LTSLASH_FILL
+    { 0xE0, 0xC1, 0x83, 0x07, 0x0E, 0x1C, 0x38, 0x70 },  // SLASH_FILL
+    { 0x07, 0x83, 0xC1, 0xE0, 0x70, 0x38, 0x1C, 0x0E },  // BKSLASH_FILL
+    { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 },  // LTBKSLASH_FILL
+    { 0xFF, 0x88, 0x88, 0x88, 0xFF, 0x88, 0x88, 0x88 },  // HATCH_FILL
+    { 0x81, 0x42, 0x24, 0x18, 0x18, 0x24, 0x42, 0x81 },  // XHATCH_FILL
+    { 0xCC, 0x33, 0xCC, 0x33, 0xCC, 0x33, 0xCC, 0x33 },  // INTERLEAVE_FILL
+    { 0x80, 0x00, 0x08, 0x00, 0x80, 0x00, 0x08, 0x00 },  // WIDE_DOT_FILL
+    { 0x88, 0x00, 0x22, 0x00, 0x88, 0x00, 0x22, 0x00 }   // CLOSE_DOT_FILL
+};
+
+// The standard BGI line styles.  The least significant bit is the first
+// pixel of the line, as with the original Borland graphics.
+static const unsigned short line_patterns[] =
+{
+    0xFFFF,     // SOLID_LINE
+    0xCCCC,     // DOTTED_LINE
+    0xFC78,     // CENTER_LINE
+    0xF8F8      // DASHED_LINE
+};
+
+
+/*****************************************************************************
+*
+*   Some helper functions
+*
+*****************************************************************************/
+// Grows the bounds of the page by the device pixels x1..x2 of row y
+static inline void touch( RasterPage& page, int x1, int x2, int y )
+{
+    page.bounds.left = std::min( page.bounds.left, x1 );
+    page.bounds.right = std::max( page.bounds.right, x2 + 1 );
+    page.bounds.top = std::min( page.bounds.top, y );
+    page.bounds.bottom = std::max( page.bounds.bottom, y + 1 );
+}
+
+// Writes one pixel that is known to be inside of the clip rectangle
+static inline void plot( RasterPage& page, int x, int y, unsigned int color )
+{
+    unsigned int* p = page.pixels + y*page.width + x;
+    touch( page, x, x, y );
+    *p = page.xorMode ? (*p ^ color) : color;
+}
+
+// Returns the pixel of the fill for the device position (x, y)
+static inline unsigned int fill_pixel( const RasterFill& fill, int x, int y )
+{
+    if ( fill.pattern == NULL )
+        return fill.color;
+    return ( fill.pattern[y & 7] & (0x80 >> (x & 7)) ) ? fill.color : fill.bkColor;
+}
+
+// Fills device pixels x1..x2 of device row y, clipped
+static void span( RasterPage& page, int x1, int x2, int y, const RasterFill& fill )
+{
+    if ( y < page.top || y >= page.bottom )
+        return;
+    x1 = std::max( x1, page.left );
+    x2 = std::min( x2, page.right - 1 );
+    if ( x1 > x2 )
+        return;
+
+    touch( page, x1, x2, y );
+    unsigned int* row = page.pixels + y*page.width;
+    if ( fill.pattern == NULL && !page.xorMode )
+        std::fill_n( row + x1, x2 - x1 + 1, fill.color );
+    else
+        for ( int x = x1; x <= x2; x++ )
+        {
+            unsigned int color = fill_pixel( fill, x, y );
+            row[x] = page.xorMode ? (row[x] ^ color) : color;
+        }
+}
+
+static inline bool overlaps( const RasterRect& a, const RasterRect& b )
+{
+    return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+}
+
+static inline RasterRect unite( const RasterRect& a, const RasterRect& b )
+{
+    RasterRect r = { std::min( a.left, b.left ), std::min( a.top, b.top ),
+                     std::max( a.right, b.right ), std::max( a.bottom, b.bottom ) };
+    return r;
+}
+
+static inline long area( const RasterRect& r )
+{
+    return (long)(r.right - r.left) * (r.bottom - r.top);
+}
+
+// Scan converts a polygon given in device coordinates (doubles)
+static void polygon( RasterPage& page, int n, const double* xy, const RasterFill& fill )
+{
+    double ymin = xy[1], ymax = xy[1];
+    for ( int i = 1; i < n; i++ )
+    {
+        ymin = std::min( ymin, xy[i*2 + 1] );
+        ymax = std::max( ymax, xy[i*2 + 1] );
+    }
+
+    // A row is inside when its center (y + 0.5) is, so do the same for columns
+    int y1 = std::max( (int)ceil( ymin - 0.5 ), page.top );
+    int y2 = std::min( (int)ceil( ymax - 0.5 ) - 1, page.bottom - 1 );
+    std::vector<double> crossings;
+    crossings.reserve( n );
+
+    for ( int y = y1; y <= y2; y++ )
+    {
+        double yc = y + 0.5;
+
+        crossings.clear( );
+        for ( int i = 0, j = n - 1; i < n; j = i++ )
+        {
+            double xa = xy[j*2], ya = xy[j*2 + 1];
+            double xb = xy[i*2], yb = xy[i*2 + 1];
+            if ( (ya <= yc && yc < yb) || (yb <= yc && yc < ya) )
+                crossings.push_back( xa + (yc - ya) * (xb - xa) / (yb - ya) );
+        }
+        std::sort( crossings.begin( ), crossings.end( ) );
+
+        // Even-odd rule: fill between each pair of crossings
+        for ( size_t k = 0; k + 1 < crossings.size( ); k += 2 )
+            span( page, (int)ceil( crossings[k] - 0.5 ), (int)ceil( crossings[k+1] - 0.5 ) - 1, y, fill );
+    }
+}
+
+
+// Returns whether a polygon given in page pixels has a single top and a
+// single bottom, that is whether going around it, it only turns from going
+// down to going up once and back once (horizontal edges do not count).
+// Convex polygons always do, and then every row crosses its edges twice.
+static bool monotone( int n, const int* xy )
+{
+    int turns = 0, last = 0;
+
+    for ( int pass = 0; pass < 2; pass++ )
+        for ( int i = 0, j = n - 1; i < n; j = i++ )
+        {
+            int dir = (xy[i*2 + 1] > xy[j*2 + 1]) - (xy[i*2 + 1] < xy[j*2 + 1]);
+            if ( dir == 0 )
+                continue;
+            // The first pass only finds the direction the second starts with
+            if ( pass == 1 && dir != last )
+                turns++;
+            last = dir;
+        }
+    return turns <= 2;
+}
+
+
+// One edge of a polygon while its rows are scanned: the column of the
+// crossing of row y is x + ceil( (y - top) * dx / dy ), kept as x and the
+// remainder r = x*dy - exact crossing*dy, 0 <= r < dy, so stepping a row only
+// adds and the crossings are exactly those polygon( ) computes.
+struct Edge
+{
+    int x, r;                   // Crossing column of the current row and its remainder
+    int step, rstep;            // dx / dy rounded down, and what that leaves
+    int dy;
+    int bottom;                 // First row below the edge
+};
+
+static void start_edge( Edge& e, const int* a, const int* b, int y )
+{
+    if ( a[1] > b[1] )
+        std::swap( a, b );
+    long long dx = b[0] - a[0], dy = b[1] - a[1];
+    long long num = (long long)(y - a[1]) * dx;
+
+    // Floor divisions, whatever the signs
+    long long q = num / dy, step = dx / dy;
+    if ( q * dy > num )
+        q--;
+    if ( step * dy > dx )
+        step--;
+    if ( q * dy != num )
+        q++;                    // ceil
+    e.x = a[0] + (int)q;
+    e.r = (int)(q * dy - num);
+    e.step = (int)step;
+    e.rstep = (int)(dx - step * dy);
+    e.dy = (int)dy;
+    e.bottom = b[1];
+}
+
+static inline void step_edge( Edge& e )
+{
+    e.x += e.step;
+    e.r -= e.rstep;
+    if ( e.r < 0 )
+    {
+        e.r += e.dy;
+        e.x++;
+    }
+}
+
+
+// Scan converts a polygon with a single top and bottom (see monotone),
+// given as integer pixel centers in page pixels.  The two chains of edges
+// going down from the top are walked together, one crossing each per row.
+static void monotone_polygon( RasterPage& page, int n, const int* xy, const RasterFill& fill )
+{
+    int top = 0, ymax = xy[1];
+    for ( int i = 1; i < n; i++ )
+    {
+        if ( xy[i*2 + 1] < xy[top*2 + 1] )
+            top = i;
+        ymax = std::max( ymax, xy[i*2 + 1] );
+    }
+
+    int y1 = std::max( xy[top*2 + 1], page.top );
+    int y2 = std::min( ymax, page.bottom );
+    if ( y1 >= y2 )
+        return;
+
+    // Chain a goes forward from the top vertex, chain b backwards
+    int ia = top, ib = top;
+    Edge a, b;
+    a.bottom = b.bottom = xy[top*2 + 1];
+    for ( int y = y1; y < y2; y++ )
+    {
+        while ( a.bottom <= y )
+        {
+            int next = (ia + 1) % n;
+            if ( xy[next*2 + 1] > y )
+                start_edge( a, &xy[ia*2], &xy[next*2], y );
+            else
+                a.bottom = xy[next*2 + 1];
+            ia = next;
+        }
+        while ( b.bottom <= y )
+        {
+            int next = (ib + n - 1) % n;
+            if ( xy[next*2 + 1] > y )
+                start_edge( b, &xy[ib*2], &xy[next*2], y );
+            else
+                b.bottom = xy[next*2 + 1];
+            ib = next;
+        }
+        span( page, std::min( a.x, b.x ), std::max( a.x, b.x ) - 1, y, fill );
+        step_edge( a );
+        step_edge( b );
+    }
+}
+
+
+// Scan converts a polygon given as integer pixel centers in page pixels.  A
+// polygon with a single top and bottom is walked along its edges, any other
+// is scanned with the even-odd rule; both fill the same pixels.
+static void int_polygon( RasterPage& page, int n, const int* xy, const RasterFill& fill )
+{
+    if ( monotone( n, xy ) )
+    {
+        monotone_polygon( page, n, xy, fill );
+        return;
+    }
+
+    std::vector<double> centers( n*2 );
+    for ( int i = 0; i < n*2; i++ )
+        centers[i] = xy[i] + 0.5;
+    polygon( page, n, centers.data( ), fill );
+}
+
+
+// Draws a line given in page pixels, both end points included
+static void line( RasterPage& page, int x1, int y1, int x2, int y2,
+                  unsigned int color, int thickness, unsigned short pattern )
+{
+    if ( thickness > 1 )
+    {
+        // A rectangle around the line, extended by half the thickness at
+        // both ends for the square caps.
+        double dx = x2 - x1, dy = y2 - y1;
+        double length = sqrt( dx*dx + dy*dy );
+        double h = thickness / 2.0;
+        if ( length == 0 )
+        {
+            dx = 1;
+            dy = 0;
+        }
+        else
+        {
+            dx /= length;
+            dy /= length;
+        }
+        // Pixel centers are at half coordinates
+        double ax = x1 + 0.5 - dx*h, ay = y1 + 0.5 - dy*h;
+        double bx = x2 + 0.5 + dx*h, by = y2 + 0.5 + dy*h;
+        double quad[8] =
+        {
+            ax + dy*h, ay - dx*h,
+            bx + dy*h, by - dx*h,
+            bx - dy*h, by + dx*h,
+            ax - dy*h, ay + dx*h
+        };
+        RasterFill fill = { color, color, NULL };
+        polygon( page, 4, quad, fill );
+        return;
+    }
+
+    // Bresenham, with the pattern bit of each step
+    int dx = abs( x2 - x1 ), sx = x1 < x2 ? 1 : -1;
+    int dy = -abs( y2 - y1 ), sy = y1 < y2 ? 1 : -1;
+    int err = dx + dy;
+    for ( int i = 0; ; i++ )
+    {
+        if ( (pattern & (1 << (i & 15)))
+             && x1 >= page.left && x1 < page.right && y1 >= page.top && y1 < page.bottom )
+            plot( page, x1, y1, color );
+        if ( x1 == x2 && y1 == y2 )
+            break;
+        int e2 = 2*err;
+        if ( e2 >= dy )
+        {
+            err += dy;
+            x1 += sx;
+        }
+        if ( e2 <= dx )
+        {
+            err += dx;
+            y1 += sy;
+        }
+    }
+}
+
+
+// Circles up to this radius take their spans and outline from tables
+#define TABLE_RADIUS 64
+
+// For every radius r up to TABLE_RADIUS, the half width of each row of the
+// filled circle (dy = 0..r), and the points RasterArc joins for the full
+// circle from 0 to 360 degrees, as (dx, dy) pairs from the center.
+struct CircleTables
+{
+    std::vector<int> half[TABLE_RADIUS + 1];
+    std::vector<int> outline[TABLE_RADIUS + 1];
+};
+
+// The half width of row dy is the largest h with h <= sqrt(r^2 - dy^2) + 0.5,
+// which RasterEllipse rounds to as well.  Both are integers, so it is found
+// going down from the widest row, h only ever shrinking: (2h - 1)^2 <= 4(r^2 - dy^2).
+static void circle_spans( int r, std::vector<int>& half )
+{
+    half.resize( r + 1 );
+    for ( int dy = 0, h = r; dy <= r; dy++ )
+    {
+        while ( h > 0 && (2*h - 1)*(2*h - 1) > 4*(r*r - dy*dy) )
+            h--;
+        half[dy] = h;
+    }
+}
+
+// The points are found exactly as RasterArc finds them, keeping only those
+// it draws a line to.
+static void circle_outline( int r, std::vector<int>& points )
+{
+    double sweep = 360 * M_PI / 180;
+    int steps = std::max( 8, (int)( sweep * r / 2 ) );
+    int px = (int)lround( r * cos( 0.0 ) ), py = -(int)lround( r * sin( 0.0 ) );
+
+    points.push_back( px );
+    points.push_back( py );
+    for ( int i = 1; i <= steps; i++ )
+    {
+        double a = sweep * i / steps;
+        int qx = (int)lround( r * cos( a ) );
+        int qy = -(int)lround( r * sin( a ) );
+        if ( qx != px || qy != py || i == steps )
+        {
+            points.push_back( qx );
+            points.push_back( qy );
+        }
+        px = qx;
+        py = qy;
+    }
+}
+
+static CircleTables build_circle_tables( )
+{
+    CircleTables tables;
+
+    for ( int r = 0; r <= TABLE_RADIUS; r++ )
+    {
+        circle_spans( r, tables.half[r] );
+        circle_outline( r, tables.outline[r] );
+    }
+    return tables;
+}
+
+// The tables are built by the first thread to draw a circle
+static const CircleTables& circle_tables( )
+{
+    static const CircleTables tables = build_circle_tables( );
+    return tables;
+}
+
+
+/*****************************************************************************
+*
+*   The exported functions are implemented below
+*
+*****************************************************************************/
+RasterRect RasterEmptyRect( )
+{
+    RasterRect r = { 0x7FFFFFFF, 0x7FFFFFFF, -0x7FFFFFFF, -0x7FFFFFFF };
+    return r;
+}
+
+
+void RasterDamageClear( RasterDamage& damage )
+{
+    damage.count = 0;
+}
+
+
+void RasterDamageAdd( RasterDamage& damage, RasterRect rect, int width, int height )
+{
+    rect.left = std::max( rect.left, 0 );
+    rect.top = std::max( rect.top, 0 );
+    rect.right = std::min( rect.right, width );
+    rect.bottom = std::min( rect.bottom, height );
+    if ( rect.left >= rect.right || rect.top >= rect.bottom )
+        return;
+
+    for ( ;; )
+    {
+        // Absorb the rectangles that overlap the new one.  Then start over,
+        // since the grown rectangle may overlap some that were checked.
+        for ( int i = 0; i < damage.count; )
+            if ( overlaps( damage.rects[i], rect ) )
+            {
+                rect = unite( damage.rects[i], rect );
+                damage.rects[i] = damage.rects[--damage.count];
+                i = 0;
+            }
+            else
+                i++;
+
+        if ( damage.count < RASTER_MAX_DAMAGE )
+            break;
+
+        // The list is full: merge with the rectangle that grows the least
+        int best = 0;
+        long growth, best_growth = -1;
+        for ( int i = 0; i < damage.count; i++ )
+        {
+            growth = area( unite( damage.rects[i], rect ) ) - area( damage.rects[i] );
+            if ( best_growth < 0 || growth < best_growth )
+            {
+                best = i;
+                best_growth = growth;
+            }
+        }
+        rect = unite( damage.rects[best], rect );
+        damage.rects[best] = damage.rects[--damage.count];
+    }
+    damage.rects[damage.count++] = rect;
+}
+
+
+void RasterDamageAdd( RasterDamage& damage, const RasterDamage& other, int width, int height )
+{
+    for ( int i = 0; i < other.count; i++ )
+        RasterDamageAdd( damage, other.rects[i], width, height );
+}
+
+
+long RasterDamageArea( const RasterDamage& damage )
+{
+    long total = 0;
+
+    // The rectangles never overlap
+    for ( int i = 0; i < damage.count; i++ )
+        total += area( damage.rects[i] );
+    return total;
+}
+
+
+unsigned int RasterColor( int rgb )
+{
+    return ((rgb & 0xFF) << 16) | (rgb & 0xFF00) | ((rgb >> 16) & 0xFF);
+}
+
+
+int RasterToRGB( unsigned int pixel )
+{
+    return ((pixel & 0xFF) << 16) | (pixel & 0xFF00) | ((pixel >> 16) & 0xFF);
+}
+
+
+const unsigned char* RasterFillPattern( int style )
+{
+    if ( style < 0 || style >= (int)(sizeof( fill_patterns ) / sizeof( fill_patterns[0] )) || style == 1 )
+        return NULL;
+    return fill_patterns[style];
+}
+
+
+unsigned short RasterLinePattern( int style, unsigned upattern )
+{
+    if ( style >= 0 && style < (int)(sizeof( line_patterns ) / sizeof( line_patterns[0] )) )
+        return line_patterns[style];
+    return (unsigned short)upattern;
+}
+
+
+void RasterSpan( RasterPage& page, int x1, int x2, int y, const RasterFill& fill )
+{
+    if ( x1 > x2 )
+        std::swap( x1, x2 );
+    span( page, x1 + page.xorg, x2 + page.xorg, y + page.yorg, fill );
+}
+
+
+void RasterPixel( RasterPage& page, int x, int y, unsigned int color )
+{
+    x += page.xorg;
+    y += page.yorg;
+    if ( x >= page.left && x < page.right && y >= page.top && y < page.bottom )
+        plot( page, x, y, color );
+}
+
+
+bool RasterGetPixel( const RasterPage& page, int x, int y, unsigned int* color )
+{
+    x += page.xorg;
+    y += page.yorg;
+    if ( x < 0 || y < 0 || x >= page.width || y >= page.height )
+        return false;
+    *color = page.pixels[y*page.width + x];
+    return true;
+}
+
+
+void RasterLine( RasterPage& page, int x1, int y1, int x2, int y2,
+                 unsigned int color, int thickness, unsigned short pattern )
+{
+    line( page, x1 + page.xorg, y1 + page.yorg, x2 + page.xorg, y2 + page.yorg, color, thickness, pattern );
+}
+
+
+// The pixels of a row whose centers are within r of the segment are those
+// within r of either end, or over the segment and within r of its line.
+// The capsule is convex, so their union is a single span.
+void RasterCapsule( RasterPage& page, int x1, int y1, int x2, int y2, int thickness, unsigned int color )
+{
+    x1 += page.xorg;  y1 += page.yorg;
+    x2 += page.xorg;  y2 += page.yorg;
+
+    if ( thickness <= 1 )
+    {
+        line( page, x1, y1, x2, y2, color, 1, 0xFFFF );
+        return;
+    }
+
+    double r = thickness / 2.0;
+    double dx = x2 - x1, dy = y2 - y1;
+    double length = sqrt( dx*dx + dy*dy );
+    int top = std::max( (int)ceil( std::min( y1, y2 ) - r ), page.top );
+    int bottom = std::min( (int)floor( std::max( y1, y2 ) + r ), page.bottom - 1 );
+    RasterFill fill = { color, color, NULL };
+
+    for ( int y = top; y <= bottom; y++ )
+    {
+        double lo = HUGE_VAL, hi = -HUGE_VAL;
+
+        // The round ends
+        for ( int end = 0; end < 2; end++ )
+        {
+            double cx = end ? x2 : x1, cy = end ? y2 : y1;
+            double h2 = r*r - (y - cy)*(y - cy);
+            if ( h2 >= 0 )
+            {
+                double h = sqrt( h2 );
+                lo = std::min( lo, cx - h );
+                hi = std::max( hi, cx + h );
+            }
+        }
+
+        // The body: 0 <= (p - a).d <= length^2 and |(p - a) x d| <= r * length
+        if ( length > 0 )
+        {
+            double ry = y - y1;
+            double a = -HUGE_VAL, b = HUGE_VAL;
+            if ( dx != 0 )
+            {
+                double t0 = x1 - ry*dy/dx, t1 = x1 + (length*length - ry*dy)/dx;
+                a = std::min( t0, t1 );
+                b = std::max( t0, t1 );
+            }
+            else if ( ry*dy < 0 || ry*dy > length*length )
+                b = a;
+            if ( dy != 0 )
+            {
+                double c0 = x1 + (ry*dx - r*length)/dy, c1 = x1 + (ry*dx + r*length)/dy;
+                a = std::max( a, std::min( c0, c1 ) );
+                b = std::min( b, std::max( c0, c1 ) );
+            }
+            else if ( fabs( ry*dx ) > r*length )
+                b = a;
+            if ( a < b )
+            {
+                lo = std::min( lo, a );
+                hi = std::max( hi, b );
+            }
+        }
+
+        if ( lo <= hi )
+            span( page, (int)ceil( lo ), (int)floor( hi ), y, fill );
+    }
+}
+
+
+void RasterPolygon( RasterPage& page, int n_points, const int* points, const RasterFill& fill )
+{
+    if ( n_points < 3 )
+        return;
+
+    std::vector<int> xy( points, points + n_points*2 );
+    for ( int i = 0; i < n_points; i++ )
+    {
+        xy[i*2] += page.xorg;
+        xy[i*2 + 1] += page.yorg;
+    }
+    int_polygon( page, n_points, xy.data( ), fill );
+}
+
+
+void RasterFillPoly( RasterPage& page, int n_points, const int* points, const RasterFill& fill,
+                     unsigned int color, int thickness, unsigned short pattern )
+{
+    // The small polygons of a game fit on the stack
+    int local[2*16];
+    std::vector<int> heap;
+    int* xy = local;
+    if ( n_points > 16 )
+    {
+        heap.resize( n_points*2 );
+        xy = heap.data( );
+    }
+
+    for ( int i = 0; i < n_points; i++ )
+    {
+        xy[i*2] = points[i*2] + page.xorg;
+        xy[i*2 + 1] = points[i*2 + 1] + page.yorg;
+    }
+    if ( n_points >= 3 )
+        int_polygon( page, n_points, xy, fill );
+    for ( int i = 0, j = n_points - 1; i < n_points; j = i++ )
+        line( page, xy[j*2], xy[j*2 + 1], xy[i*2], xy[i*2 + 1], color, thickness, pattern );
+}
+
+
+void RasterPolygon( RasterPage& page, int n_points, const double* points, const RasterFill& fill )
+{
+    if ( n_points < 3 )
+        return;
+
+    std::vector<double> xy( n_points*2 );
+    for ( int i = 0; i < n_points; i++ )
+    {
+        xy[i*2] = points[i*2] + page.xorg + 0.5;
+        xy[i*2 + 1] = points[i*2 + 1] + page.yorg + 0.5;
+    }
+    polygon( page, n_points, xy.data( ), fill );
+}
+
+
+void RasterEllipse( RasterPage& page, int x, int y, int xradius, int yradius, const RasterFill& fill )
+{
+    x += page.xorg;
+    y += page.yorg;
+    xradius = abs( xradius );
+    yradius = abs( yradius );
+    if ( yradius == 0 )
+    {
+        span( page, x - xradius, x + xradius, y, fill );
+        return;
+    }
+    if ( xradius == yradius && xradius <= TABLE_RADIUS )
+    {
+        const std::vector<int>& half = circle_tables( ).half[xradius];
+        for ( int dy = -yradius; dy <= yradius; dy++ )
+            span( page, x - half[abs( dy )], x + half[abs( dy )], y + dy, fill );
+        return;
+    }
+
+
+    for ( int dy = -yradius; dy <= yradius; dy++ )
+    {
+        double t = (double)dy / yradius;
+        int half = (int)( xradius * sqrt( std::max( 0.0, 1.0 - t*t ) ) + 0.5 );
+        span( page, x - half, x + half, y + dy, fill );
+    }
+}
+
+
+void RasterArc( RasterPage& page, int x, int y, int stangle, int endangle, int xradius, int yradius,
+                unsigned int color, int thickness )
+{
+    // Angles go counterclockwise; a full turn when they meet
+    while ( endangle <= stangle )
+        endangle += 360;
+
+    if ( stangle == 0 && endangle == 360 && xradius == yradius && xradius >= 0 && xradius <= TABLE_RADIUS )
+    {
+        const std::vector<int>& points = circle_tables( ).outline[xradius];
+        x += page.xorg;
+        y += page.yorg;
+        for ( size_t i = 2; i < points.size( ); i += 2 )
+            line( page, x + points[i - 2], y + points[i - 1], x + points[i], y + points[i + 1],
+                  color, thickness, 0xFFFF );
+        return;
+    }
+    double start = stangle * M_PI / 180, sweep = (endangle - stangle) * M_PI / 180;
+
+    // Segments of about two pixels along the curve
+    int steps = std::max( 8, (int)( sweep * std::max( xradius, yradius ) / 2 ) );
+    int px = x + (int)lround( xradius * cos( start ) );
+    int py = y - (int)lround( yradius * sin( start ) );
+    for ( int i = 1; i <= steps; i++ )
+    {
+        double a = start + sweep * i / steps;
+        int qx = x + (int)lround( xradius * cos( a ) );
+        int qy = y - (int)lround( yradius * sin( a ) );
+        if ( qx != px || qy != py || i == steps )
+            RasterLine( page, px, py, qx, qy, color, thickness, 0xFFFF );
+        px = qx;
+        py = qy;
+    }
+}
+
+
+// A run of pixels of a row to fill from, found filled on the row it was
+// reached from (row - dy), and the direction the fill goes on in.
+struct FillSpan
+{
+    int row, x1, x2, dy;
+};
+
+// The marks of the filled pixels and the stack of spans are kept from fill
+// to fill, by each thread that fills.  The marks are all clear between fills:
+// a fill clears the rows it marked when it is done, so its cost follows the
+// area filled and not the size of the page.
+//
+// Each span popped is scanned for runs of open pixels, the first one grown
+// to the left and every one to the right.  A run goes on to the next row,
+// and back to the previous one only where it leaks past the span it came
+// from, so most pixels are only looked at once or twice.
+void RasterFloodFill( RasterPage& page, int x, int y, unsigned int border, const RasterFill& fill )
+{
+    static thread_local std::vector<unsigned char> done;
+    static thread_local std::vector<FillSpan> spans;
+
+    x += page.xorg;
+    y += page.yorg;
+    if ( x < page.left || x >= page.right || y < page.top || y >= page.bottom )
+        return;
+
+    int width = page.width;
+    unsigned int* pixels = page.pixels;
+    if ( pixels[y*width + x] == border )
+        return;
+
+    // Remember what was filled already, since a pattern fill leaves pixels
+    // that still look unfilled.
+    if ( done.size( ) < (size_t)width * page.height )
+        done.resize( (size_t)width * page.height, 0 );
+    RasterRect filled = RasterEmptyRect( );
+    spans.clear( );
+    FillSpan up = { y, x, x, -1 }, down = { y + 1, x, x, 1 };
+    if ( down.row < page.bottom )
+        spans.push_back( down );
+    spans.push_back( up );
+
+    while ( !spans.empty( ) )
+    {
+        FillSpan from = spans.back( );
+        spans.pop_back( );
+        const unsigned int* row = pixels + from.row*width;
+        unsigned char* mark = &done[(size_t)from.row*width];
+
+        for ( x = from.x1; x <= from.x2; x++ )
+        {
+            if ( mark[x] || row[x] == border )
+                continue;
+
+            // A run of open pixels: only the first one may reach left of the span
+            int x1 = x, x2 = x;
+            if ( x == from.x1 )
+                while ( x1 > page.left && !mark[x1-1] && row[x1-1] != border )
+                    x1--;
+            while ( x2 < page.right - 1 && !mark[x2+1] && row[x2+1] != border )
+                x2++;
+
+            span( page, x1, x2, from.row, fill );
+            memset( mark + x1, 1, x2 - x1 + 1 );
+            filled.left = std::min( filled.left, x1 );
+            filled.right = std::max( filled.right, x2 + 1 );
+            filled.top = std::min( filled.top, from.row );
+            filled.bottom = std::max( filled.bottom, from.row + 1 );
+
+            FillSpan next = { from.row + from.dy, x1, x2, from.dy };
+            if ( next.row >= page.top && next.row < page.bottom )
+                spans.push_back( next );
+            FillSpan back = { from.row - from.dy, x1, from.x1 - 1, -from.dy };
+            if ( x1 < from.x1 && back.row >= page.top && back.row < page.bottom )
+                spans.push_back( back );
+            back.x1 = from.x2 + 1;
+            back.x2 = x2;
+            if ( x2 > from.x2 && back.row >= page.top && back.row < page.bottom )
+                spans.push_back( back );
+            x = x2 + 1;
+        }
+    }
+
+    for ( int i = filled.top; i < filled.bottom; i++ )
+        memset( &done[(size_t)i*width + filled.left], 0, filled.right - filled.left );
+}
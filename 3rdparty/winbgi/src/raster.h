@@ -0,0 +1,134 @@
+// File: raster.h
+//
+// Portable rasterization of the BGI primitives into a plain 32-bit page.
+// Pixels are 0x00RRGGBB words, rows of width pixels from the top: this is
+// both the layout of the software backend pages and of the top-down 32-bit
+// DIB sections behind the GDI pages, so either backend can draw with it.
+//
+
+#ifndef RASTER_H
+#define RASTER_H
+
+// ---------------------------------------------------------------------------
+//                              Structures
+// ---------------------------------------------------------------------------
+// A rectangle of page pixels, right and bottom excluded
+struct RasterRect
+{
+    int left, top;
+    int right, bottom;
+};
+
+
+// A page to draw into.  Coordinates given to the Raster functions are
+// relative to (xorg, yorg), just like BGI coordinates are relative to the
+// viewport.  Nothing is drawn outside the clip rectangle (in page pixels,
+// right and bottom excluded).  Every pixel written grows bounds, so the
+// caller knows afterwards which part of the page was touched.
+struct RasterPage
+{
+    unsigned int* pixels;       // First pixel of the top row
+    int width, height;          // Size of the page in pixels
+    int xorg, yorg;             // Origin of the coordinates (viewport corner)
+    int left, top;              // Clip rectangle
+    int right, bottom;
+    bool xorMode;               // XOR_PUT rather than COPY_PUT
+    RasterRect bounds;          // Pixels written so far (empty when right <= left)
+};
+
+
+// The damaged part of a page as a short list of rectangles.  Overlapping
+// rectangles are merged, and once the list is full a new rectangle is merged
+// into the one it grows the least, so the list stays bounded at the cost of
+// covering some undamaged pixels.
+#define RASTER_MAX_DAMAGE 16
+struct RasterDamage
+{
+    int count;
+    RasterRect rects[RASTER_MAX_DAMAGE];
+};
+
+
+// How an area is filled: either a solid color, or an 8x8 pattern (most
+// significant bit leftmost) with color for set bits and bkColor for clear ones.
+struct RasterFill
+{
+    unsigned int color;         // Pixel value for the set bits
+    unsigned int bkColor;       // Pixel value for the clear bits
+    const unsigned char* pattern; // NULL for a solid fill
+};
+
+
+// ---------------------------------------------------------------------------
+//                              Prototypes
+// ---------------------------------------------------------------------------
+// Returns an empty rectangle, to start the bounds of a page with
+RasterRect RasterEmptyRect( );
+
+// Empties a damage list
+void RasterDamageClear( RasterDamage& damage );
+
+// Adds a rectangle to a damage list, clipped to a width x height page
+void RasterDamageAdd( RasterDamage& damage, RasterRect rect, int width, int height );
+
+// Adds every rectangle of other to a damage list
+void RasterDamageAdd( RasterDamage& damage, const RasterDamage& other, int width, int height );
+
+// Returns the number of pixels covered by a damage list
+long RasterDamageArea( const RasterDamage& damage );
+
+// Converts a Windows COLORREF (0x00BBGGRR) into a page pixel
+unsigned int RasterColor( int rgb );
+
+// Converts a page pixel back into a COLORREF
+int RasterToRGB( unsigned int pixel );
+
+// Returns the 8x8 pattern of a standard BGI fill style (NULL for SOLID_FILL)
+const unsigned char* RasterFillPattern( int style );
+
+// Returns the 16 bit pattern of a standard BGI line style
+unsigned short RasterLinePattern( int style, unsigned upattern );
+
+// Fills the pixels x1..x2 (both included) of row y
+void RasterSpan( RasterPage& page, int x1, int x2, int y, const RasterFill& fill );
+
+// Sets a single pixel
+void RasterPixel( RasterPage& page, int x, int y, unsigned int color );
+
+// Reads a single pixel, returns false if it is outside of the page
+bool RasterGetPixel( const RasterPage& page, int x, int y, unsigned int* color );
+
+// Draws a line, both end points included.  Lines thicker than one pixel are
+// drawn solid with square end caps, like the geometric GDI pen.
+void RasterLine( RasterPage& page, int x1, int y1, int x2, int y2,
+                 unsigned int color, int thickness, unsigned short pattern );
+
+// Draws a line with round ends, thickness pixels across: every pixel whose
+// center is at most thickness / 2 from the segment.  Lines one pixel thick
+// or less are drawn like RasterLine.
+void RasterCapsule( RasterPage& page, int x1, int y1, int x2, int y2, int thickness, unsigned int color );
+
+// Fills a polygon with the even-odd rule, sampling at pixel centers.  Vertex
+// (x, y) is the center of pixel (x, y), for integer and fractional vertices alike.
+void RasterPolygon( RasterPage& page, int n_points, const int* points, const RasterFill& fill );
+void RasterPolygon( RasterPage& page, int n_points, const double* points, const RasterFill& fill );
+
+// Fills a polygon of integer vertices like RasterPolygon and outlines it with
+// lines like RasterLine, as fillpoly does.  The vertices are translated once
+// for both; the outline is still drawn edge by edge on its own.  Polygons
+// with a single top and bottom, convex ones among them, are filled by walking
+// their two chains of edges a row at a time.
+void RasterFillPoly( RasterPage& page, int n_points, const int* points, const RasterFill& fill,
+                     unsigned int color, int thickness, unsigned short pattern );
+
+// Fills an axis aligned ellipse
+void RasterEllipse( RasterPage& page, int x, int y, int xradius, int yradius, const RasterFill& fill );
+
+// Draws an elliptical arc from stangle to endangle (degrees, counterclockwise)
+void RasterArc( RasterPage& page, int x, int y, int stangle, int endangle, int xradius, int yradius,
+                unsigned int color, int thickness );
+
+// Fills the area around (x, y) which is bounded by the border color
+void RasterFloodFill( RasterPage& page, int x, int y, unsigned int border, const RasterFill& fill );
+
+#endif // RASTER_H
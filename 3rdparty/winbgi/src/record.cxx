@@ -0,0 +1,149 @@
+// File: record.cxx
+//
+// Recording of the drawing calls.  Every drawing function takes the DC lock
+// for its GDI calls, and the paint thread competes for the same lock.  With
+// recording on (setrecordingbgi), the calls that draw on the active page or
+// change how the DCs draw are kept in a list instead, and BGI__Flush replays
+// them all in order under a single lock when the frame is shown by
+// swapbuffers, or when something needs to read the page.
+//
+// The replay calls the same functions again with recording off.  The state
+// they keep in WindowData (colors, styles, viewport) was already set when
+// they were recorded, and replaying walks it through the same values again,
+// so each call draws exactly as it would have when it was made.
+//
+
+
+#include <windows.h>        // Provides the Win32 API
+#include <string.h>         // Provides memcpy
+#include "winbgim.h"         // API routines
+#include "winbgitypes.h"    // Internal structure data
+
+
+/*****************************************************************************
+*
+*   Helper functions
+*
+*****************************************************************************/
+
+// The data of the commands is kept aligned for any of the structures copied
+// there (points, a BITMAP header).
+static size_t aligned( size_t size )
+{
+    return (size + sizeof(double) - 1) & ~(sizeof(double) - 1);
+}
+
+bool BGI__Record( recorded_call call, const int* args, int count,
+                  const void* data, size_t size, const void* more, size_t moresize )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    DrawCommand command;
+
+    if ( !pWndData->recording )
+        return false;
+
+    command.call = call;
+    memcpy( command.args, args, count * sizeof(int) );
+    command.data = pWndData->commandData.size( );
+    if ( size + moresize > 0 )
+    {
+        pWndData->commandData.resize( command.data + aligned( size + moresize ) );
+        memcpy( &pWndData->commandData[command.data], data, size );
+        memcpy( &pWndData->commandData[command.data + size], more, moresize );
+    }
+    pWndData->commands.push_back( command );
+    return true;
+}
+
+// This function makes one recorded call again.
+static void replay( const DrawCommand& command, char* data )
+{
+    const int* a = command.args;
+
+    switch ( command.call )
+    {
+    case REC_ARC:              arc( a[0], a[1], a[2], a[3], a[4] ); break;
+    case REC_BAR:              bar( a[0], a[1], a[2], a[3] ); break;
+    case REC_BAR3D:            bar3d( a[0], a[1], a[2], a[3], a[4], a[5] ); break;
+    case REC_CIRCLE:           circle( a[0], a[1], a[2] ); break;
+    case REC_CLEARDEVICE:      cleardevice( ); break;
+    case REC_CLEARVIEWPORT:    clearviewport( ); break;
+    case REC_DRAWPOLY:         drawpoly( a[0], (int*)data ); break;
+    case REC_ELLIPSE:          ellipse( a[0], a[1], a[2], a[3], a[4], a[5] ); break;
+    case REC_FILLELLIPSE:      fillellipse( a[0], a[1], a[2], a[3] ); break;
+    case REC_FILLPOLY:         fillpoly( a[0], (int*)data ); break;
+    case REC_FLOODFILL:        floodfill( a[0], a[1], a[2] ); break;
+    case REC_LINE:             line( a[0], a[1], a[2], a[3] ); break;
+    case REC_LINEREL:          linerel( a[0], a[1] ); break;
+    case REC_LINETO:           lineto( a[0], a[1] ); break;
+    case REC_PIESLICE:         pieslice( a[0], a[1], a[2], a[3], a[4] ); break;
+    case REC_PUTPIXEL:         putpixel( a[0], a[1], a[2] ); break;
+    case REC_PUTPIXELS:        putpixels( a[0], (int*)data, (int*)data + a[0]*2 ); break;
+    case REC_RECTANGLE:        rectangle( a[0], a[1], a[2], a[3] ); break;
+    case REC_SECTOR:           sector( a[0], a[1], a[2], a[3], a[4], a[5] ); break;
+    case REC_THICKLINE:        thickline( a[0], a[1], a[2], a[3], a[4] ); break;
+    case REC_PUTIMAGE:
+        // The bits were copied right after the header
+        ((BITMAP*)data)->bmBits = data + sizeof(BITMAP);
+        putimage( a[0], a[1], data, a[2] );
+        break;
+    case REC_MOVEREL:          moverel( a[0], a[1] ); break;
+    case REC_MOVETO:           moveto( a[0], a[1] ); break;
+    case REC_SETBKCOLOR:       setbkcolor( a[0] ); break;
+    case REC_SETCOLOR:         setcolor( a[0] ); break;
+    case REC_SETLINESTYLE:     setlinestyle( a[0], (unsigned)a[1], a[2] ); break;
+    case REC_SETFILLPATTERN:   setfillpattern( data, a[0] ); break;
+    case REC_SETFILLSTYLE:     setfillstyle( a[0], a[1] ); break;
+    case REC_SETVIEWPORT:      setviewport( a[0], a[1], a[2], a[3], a[4] ); break;
+    case REC_SETWRITEMODE:     setwritemode( a[0] ); break;
+    case REC_OUTTEXT:          outtext( data ); break;
+    case REC_OUTTEXTXY:        outtextxy( a[0], a[1], data ); break;
+    case REC_SETTEXTJUSTIFY:   settextjustify( a[0], a[1] ); break;
+    case REC_SETTEXTSTYLE:     settextstyle( a[0], a[1], a[2] ); break;
+    case REC_SETUSERCHARSIZE:  setusercharsize( a[0], a[1], a[2], a[3] ); break;
+    }
+}
+
+// This function replays the recorded calls.  Their own locks only go one
+// level deeper into the lock taken here, so the DCs are locked once for all
+// of them.  The lists keep their memory for the next frame.
+void BGI__Flush( )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    std::vector<DrawCommand>& commands = pWndData->commands;
+
+    if ( !pWndData->recording || commands.empty( ) )
+        return;
+
+    BGI__LockDC( pWndData );
+    pWndData->recording = false;
+    for ( size_t i = 0; i < commands.size( ); i++ )
+        replay( commands[i], pWndData->commandData.data( ) + commands[i].data );
+    pWndData->recording = true;
+    BGI__UnlockDC( pWndData );
+
+    commands.clear( );
+    pWndData->commandData.clear( );
+}
+
+
+/*****************************************************************************
+*
+*   The actual API calls are implemented below
+*
+*****************************************************************************/
+
+bool getrecordingbgi( )
+{
+    return BGI__GetWindowDataPtr( )->recording;
+}
+
+
+// Turning recording off first draws what was recorded.
+void setrecordingbgi( bool value )
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+
+    BGI__Flush( );
+    pWndData->recording = value;
+}
@@ -125,14 +125,29 @@ static void set_align(WindowData* pWndData)
 	SetTextAlign(pWndData->hDC[i], alignment);
 }
 
-// This function updates the current hdc with the user defined font
-// POSTCONDITION: text written to the current hdc will be in the new font
+// This function returns a rectangle (logical coordinates) which holds
+// textstring drawn with its reference point at (x,y), whatever the
+// justification and direction are.
 //
-static void set_font(WindowData* pWndData)
+static RECT text_rect(HDC hDC, int x, int y, char *textstring)
+{
+    SIZE size;
+    int reach;
+
+    GetTextExtentPoint32(hDC, (LPCTSTR)textstring, strlen(textstring), &size);
+    reach = max(size.cx, size.cy) + 1;
+
+    RECT rect = { x - reach, y - reach, x + reach, y + reach };
+    return rect;
+}
+
+// This function gives the size of the characters of the current text style,
+// as it is given to CreateFont.
+//
+static void font_size(WindowData* pWndData, int* height, int* width)
 {
     int mindex;
     double xscale, yscale;
-    HFONT hFont;
 
     // get the scaling factors based on charsize
     if(pWndData->textInfo.charsize == 0)
@@ -153,27 +168,114 @@ static void set_font(WindowData* pWndData)
 	mindex = pWndData->textInfo.charsize;
     }
 
-    // with the scaling decided, make a font.
-    hFont = CreateFont(
-	int(font_metrics[pWndData->textInfo.font][mindex].height * yscale),
-	int(font_metrics[pWndData->textInfo.font][mindex].width  * xscale),
-	pWndData->textInfo.direction * 900,
-	(pWndData->textInfo.direction & 1) * 900,
-	font_weight[pWndData->textInfo.font],
-	FALSE,
-	FALSE,
-	FALSE,
-	DEFAULT_CHARSET,
-	OUT_DEFAULT_PRECIS,
-	CLIP_DEFAULT_PRECIS,
-	DEFAULT_QUALITY,
-	font_family[pWndData->textInfo.font],
-	font_name[pWndData->textInfo.font]
-	);
-
-    // assign the fonts to each of the hdcs
+    *height = int(font_metrics[pWndData->textInfo.font][mindex].height * yscale);
+    *width = int(font_metrics[pWndData->textInfo.font][mindex].width  * xscale);
+}
+
+// This function returns the size of textstring in the current text style.
+// Menus and the like measure the same strings over and over, so the sizes
+// of the latest MAX_EXTENTS strings are kept and only new ones are measured.
+// They are kept by style rather than by font, since a style set while
+// recording is only selected into the DCs when the recording is replayed,
+// which is done before measuring.
+//
+static SIZE text_extent(char *textstring)
+{
+    WindowData* pWndData = BGI__GetWindowDataPtr( );
+    std::vector<CachedExtent>& extents = pWndData->extents;
+    CachedExtent extent;
+
+    // the DCs have the stock font until a style is set
+    extent.font = pWndData->textStyled ? pWndData->textInfo.font : -1;
+    extent.direction = pWndData->textInfo.direction;
+    font_size(pWndData, &extent.height, &extent.width);
+
+    for (size_t i = 0; i < extents.size(); i++)
+	if (extents[i].font == extent.font && extents[i].direction == extent.direction &&
+	    extents[i].height == extent.height && extents[i].width == extent.width &&
+	    extents[i].text == textstring)
+	    return extents[i].size;
+
+    BGI__Flush( );
+    HDC hDC = BGI__GetWinbgiDC( );
+    GetTextExtentPoint32(hDC, (LPCTSTR) textstring, strlen(textstring), &extent.size);
+    BGI__ReleaseWinbgiDC( );
+
+    extent.text = textstring;
+    if (extents.size() < MAX_EXTENTS)
+	extents.push_back(extent);
+    else
+    {
+	extents[pWndData->nextExtent] = extent;
+	pWndData->nextExtent = (pWndData->nextExtent + 1) % MAX_EXTENTS;
+    }
+    return extent.size;
+}
+
+// This function updates the current hdc with the user defined font.  Fonts
+// are kept once created, so that switching between text styles only selects
+// a font that already exists.
+// POSTCONDITION: text written to the current hdc will be in the new font
+//
+static void set_font(WindowData* pWndData)
+{
+    int height, width;
+    HFONT hFont = NULL;
+
+    font_size(pWndData, &height, &width);
+
+    // look for a font made for the same style before
+    std::vector<CachedFont>& fonts = pWndData->fonts;
+    for (size_t i = 0; i < fonts.size(); i++)
+	if (fonts[i].font == pWndData->textInfo.font && fonts[i].direction == pWndData->textInfo.direction &&
+	    fonts[i].height == height && fonts[i].width == width)
+	{
+	    hFont = fonts[i].hFont;
+	    break;
+	}
+
+    if (hFont == pWndData->hFont && hFont != NULL)
+	return;
+
+    if (hFont == NULL)
+    {
+	// make room by deleting the oldest font that is not selected
+	if (fonts.size() >= MAX_FONTS)
+	    for (size_t i = 0; i < fonts.size(); i++)
+		if (fonts[i].hFont != pWndData->hFont)
+		{
+		    DeleteObject(fonts[i].hFont);
+		    fonts.erase(fonts.begin() + i);
+		    break;
+		}
+
+	// with the scaling decided, make a font.
+	hFont = CreateFont(
+	    height,
+	    width,
+	    pWndData->textInfo.direction * 900,
+	    (pWndData->textInfo.direction & 1) * 900,
+	    font_weight[pWndData->textInfo.font],
+	    FALSE,
+	    FALSE,
+	    FALSE,
+	    DEFAULT_CHARSET,
+	    OUT_DEFAULT_PRECIS,
+	    CLIP_DEFAULT_PRECIS,
+	    DEFAULT_QUALITY,
+	    font_family[pWndData->textInfo.font],
+	    font_name[pWndData->textInfo.font]
+	    );
+
+	CachedFont cached = { pWndData->textInfo.font, pWndData->textInfo.direction, height, width, hFont };
+	fonts.push_back(cached);
+    }
+
+    // assign the font to each of the hdcs.  The font selected before stays
+    // in the cache (or is the stock font), so it is not deleted.
     for ( int i = 0; i < MAX_PAGES; i++ )
-	DeleteObject(SelectObject( pWndData->hDC[i], hFont ));
+	SelectObject( pWndData->hDC[i], hFont );
+    pWndData->hFont = hFont;
 }
 
 
@@ -205,6 +307,9 @@ void gettextsettings(struct textsettingstype *texttypeinfo)
 //
 void outtext(char *textstring)
 {
+    if (BGI__Record(REC_OUTTEXT, NULL, 0, textstring, strlen(textstring) + 1))
+	return;
+
     HDC hDC = BGI__GetWinbgiDC( );
     WindowData* pWndData = BGI__GetWindowDataPtr( );
 
@@ -219,10 +324,10 @@ void outtext(char *textstring)
 	set_align(pWndData);
     }
 
+    RECT rect = text_rect(hDC, cp.x, cp.y, textstring);
     TextOut(hDC, 0, 0, (LPCTSTR)textstring, strlen(textstring));
     BGI__ReleaseWinbgiDC( );
-    RefreshWindow( NULL );
-    // Todo: Change to refresh only the needed part.
+    RefreshWindow( &rect );
 }
 
 // This function prints textstring to x,y
@@ -233,6 +338,10 @@ void outtext(char *textstring)
 //
 void outtextxy(int x, int y, char *textstring)
 {
+    int args[] = { x, y };
+    if (BGI__Record(REC_OUTTEXTXY, args, 2, textstring, strlen(textstring) + 1))
+	return;
+
     HDC hDC = BGI__GetWinbgiDC( );
     WindowData* pWndData = BGI__GetWindowDataPtr( );
 
@@ -243,11 +352,11 @@ void outtextxy(int x, int y, char *textstring)
 	set_align(pWndData);
     }
 
+    RECT rect = text_rect(hDC, x, y, textstring);
     TextOut(hDC, x, y, (LPCTSTR)textstring, strlen(textstring));
     BGI__ReleaseWinbgiDC( );
 
-    RefreshWindow( NULL );
-    // Todo: Change to refresh only the needed part.
+    RefreshWindow( &rect );
 }
 
 
@@ -263,9 +372,13 @@ void settextjustify(int horiz, int vert)
     pWndData->textInfo.horiz = horiz;
     pWndData->textInfo.vert  = vert;
 
-    WaitForSingleObject(pWndData->hDCMutex, 5000);
+    int args[] = { horiz, vert };
+    if (BGI__Record(REC_SETTEXTJUSTIFY, args, 2))
+	return;
+
+    BGI__LockDC( pWndData );
     set_align(pWndData);
-    ReleaseMutex(pWndData->hDCMutex);
+    BGI__UnlockDC( pWndData );
 }
 
 
@@ -281,10 +394,15 @@ void settextstyle(int font, int direction, int charsize)
     pWndData->textInfo.font = font;
     pWndData->textInfo.direction = direction;
     pWndData->textInfo.charsize = charsize;
+    pWndData->textStyled = true;
+
+    int args[] = { font, direction, charsize };
+    if (BGI__Record(REC_SETTEXTSTYLE, args, 3))
+	return;
 
-    WaitForSingleObject(pWndData->hDCMutex, 5000);
+    BGI__LockDC( pWndData );
     set_font(pWndData);
-    ReleaseMutex(pWndData->hDCMutex);
+    BGI__UnlockDC( pWndData );
 }
 
 // This function sets the size of stroked fonts
@@ -299,10 +417,15 @@ void setusercharsize(int multx, int divx, int multy, int divy)
     pWndData->t_scale[1] = divx;
     pWndData->t_scale[2] = multy;
     pWndData->t_scale[3] = divy;
+    pWndData->textStyled = true;
 
-    WaitForSingleObject(pWndData->hDCMutex, 5000);
+    int args[] = { multx, divx, multy, divy };
+    if (BGI__Record(REC_SETUSERCHARSIZE, args, 4))
+	return;
+
+    BGI__LockDC( pWndData );
     set_font(pWndData);
-    ReleaseMutex(pWndData->hDCMutex);
+    BGI__UnlockDC( pWndData );
 }
 
 // This function returns the height in pixels of textstring using the current
@@ -311,13 +434,7 @@ void setusercharsize(int multx, int divx, int multy, int divy)
 //
 int textheight(char *textstring)
 {
-    HDC hDC = BGI__GetWinbgiDC( );
-    SIZE tb;
-
-    GetTextExtentPoint32(hDC, (LPCTSTR) textstring, strlen(textstring), &tb);
-    BGI__ReleaseWinbgiDC( );
-
-    return tb.cy;
+    return text_extent(textstring).cy;
 }
 
 // This function returns the width in pixels of textstring using the current
@@ -326,13 +443,7 @@ int textheight(char *textstring)
 //
 int textwidth(char *textstring)
 {
-    HDC hDC = BGI__GetWinbgiDC( );
-    SIZE tb;
-
-    GetTextExtentPoint32(hDC, (LPCTSTR) textstring, strlen(textstring), &tb);
-    BGI__ReleaseWinbgiDC( );
-
-    return tb.cx;
+    return text_extent(textstring).cx;
 }
 
 void outstreamxy(int x, int y, std::ostringstream& out)
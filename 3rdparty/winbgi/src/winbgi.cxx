@@ -11,7 +11,9 @@
 
 #include <windows.h>            // Provides the Win32 API
 #include <windowsx.h>           // Provides message cracker macros (p. 96)
+#include <mmsystem.h>           // Provides timeBeginPeriod, timeEndPeriod
 #include <stdio.h>              // Provides sprintf
+#include <stdlib.h>             // Provides getenv
 #include <iostream>             // This is for debug only
 #include <vector>               // MGM: Added for BGI__WindowTable
 #include "winbgim.h"             // External API routines
@@ -206,18 +208,20 @@ void graphdefaults( )
 	// Using Stock stuff is more efficient.
         // Create the default pen for drawing in the window.
         hPen = GetStockPen( WHITE_PEN );
-        // Select this pen into the DC and delete the old pen.
-        DeletePen( SelectPen( pWndData->hDC[i], hPen ) );
+        // Select this pen into the DC.  The old one stays in the pen cache.
+        SelectPen( pWndData->hDC[i], hPen );
+        pWndData->hPen[i] = NULL;
 
         // Create the default brush for painting in the window.
         hBrush = GetStockBrush( WHITE_BRUSH );
-        // Select this brush into the DC and delete the old brush.
-        DeleteBrush( SelectBrush( pWndData->hDC[i], hBrush ) );
+        // Select this brush into the DC.  The old one stays in the brush cache.
+        SelectBrush( pWndData->hDC[i], hBrush );
+        pWndData->hBrush[i] = NULL;
 
 	// Set the default text color for each page
 	SetTextColor(pWndData->hDC[i], converttorgb(WHITE));
     }
-    ReleaseMutex(pWndData->hDCMutex);
+    BGI__ReleaseWinbgiDC( );
 
     // Set text font and justification to default
     pWndData->textInfo.horiz = LEFT_TEXT;
@@ -303,6 +307,27 @@ int initwindow
     pWndData->inittop = top;
     pWndData->title = title; // Converts to a string object
 
+    // Nothing is known about the pages yet, so the first cleardevice clears
+    // all of a page and the first present repaints all of the window.
+    for ( int i = 0; i < MAX_PAGES; i++ )
+    {
+        RasterDamageClear( pWndData->damage[i] );
+        pWndData->clearColor[i] = -1;
+        pWndData->hPen[i] = NULL;
+        pWndData->hBrush[i] = NULL;
+    }
+    RasterDamageClear( pWndData->presented );
+    pWndData->presentedColor = -1;
+    pWndData->hFont = NULL;
+    pWndData->textStyled = false;
+    pWndData->nextExtent = 0;
+    pWndData->recording = false;
+    pWndData->lockOwner = 0;
+    pWndData->lockDepth = 0;
+    pWndData->inFrame = false;
+    pWndData->lockCount = 0;
+    pWndData->lockStats = getenv( "BGI_LOCKSTATS" ) != NULL;
+
     hThread = CreateThread( NULL,                   // Security Attributes (use default)
                             0,                      // Stack size (use default)
                             BGI__ThreadInitWindow,  // Start routine
@@ -358,6 +383,10 @@ int initwindow
     // Set the bitmap info struct to NULL
     pWndData->pbmpInfo = NULL;
 
+    // Let delay sleep to the millisecond while the window is open, rather
+    // than to the 15.6 ms system timer (pacer.cxx)
+    timeBeginPeriod( 1 );
+
     // Set up the defaults for the window
     graphdefaults( );
 
@@ -399,6 +428,9 @@ void closegraph(int wid)
 	// Remove the HWND from the BGI__WindowTable vector:
 	BGI__WindowTable[wid] = NULL;
 
+	// Undo the timeBeginPeriod of initwindow
+	timeEndPeriod( 1 );
+
 	// Reset the global BGI__CurrentWindow if needed:
 	if (BGI__CurrentWindow == wid)
 	    BGI__CurrentWindow = NO_CURRENT_WINDOW;
@@ -927,6 +959,8 @@ void setactivepage( int page )
     if ( (page < 0) || (page > MAX_PAGES) )
         return;
 
+    // What was recorded goes on the page that was active
+    BGI__Flush( );
     pWndData->ActivePage = page;
 }
 
@@ -943,11 +977,12 @@ void setvisualpage( int page )
     if ( (page < 0) || (page > MAX_PAGES) )
         return;
 
+    BGI__Flush( );
     pWndData->VisualPage = page;
 
-    // Redraw the entire current window.  No need to erase the background as
-    // the new image is simply copied over the old one.
-    InvalidateRect( pWndData->hWnd, NULL, FALSE );
+    // Redraw what differs from the page shown before.  No need to erase the
+    // background as the new image is simply copied over the old one.
+    BGI__Present( );
 }
 
 
@@ -958,6 +993,9 @@ void swapbuffers( )
 {
     WindowData *pWndData = BGI__GetWindowDataPtr( );
 
+    // Draw the frame if it was recorded
+    BGI__Flush( );
+
     if ( pWndData->ActivePage == 0 )
     {
         pWndData->VisualPage = 0;
@@ -968,8 +1006,12 @@ void swapbuffers( )
         pWndData->VisualPage = 1;
         pWndData->ActivePage = 0;
     }
-    // Redraw the entire current window.  No need to erase the background as
-    // the new image is simply copied over the old one.
-    InvalidateRect( pWndData->hWnd, NULL, FALSE );
+    // Redraw what differs from the page shown before.  No need to erase the
+    // background as the new image is simply copied over the old one.
+    BGI__Present( );
+
+    if ( pWndData->lockStats )
+        std::cerr << "winbgi: " << pWndData->lockCount << " DC locks this frame" << std::endl;
+    pWndData->lockCount = 0;
 }
 
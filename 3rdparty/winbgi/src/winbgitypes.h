@@ -13,17 +13,101 @@
 
 #include <windows.h>            // Provides the Win32 API
 #include <tchar.h>              // Provides the _T macro
+#include <atomic>               // Provides std::atomic
 #include <queue>                // Provides STL queue class
 #include <string>               // Provides STL string class
+#include <vector>               // Provides STL vector class
 #include "winbgim.h"            // Provides other structures
+#include "raster.h"             // Provides RasterDamage
 
 // Define maximum pages used for drawing.
 #define MAX_PAGES 4
+// Define maximum fonts kept by set_font (text.cxx)
+#define MAX_FONTS 32
+// Define maximum text sizes kept by textwidth and textheight (text.cxx)
+#define MAX_EXTENTS 64
+// Define maximum pens and brushes kept by setcolor, setlinestyle,
+// setfillstyle and setfillpattern (misc.cxx)
+#define MAX_PENS 32
+#define MAX_BRUSHES 32
 typedef void (*Handler)(int, int);
 
 // ---------------------------------------------------------------------------
 //                              Structures
 // ---------------------------------------------------------------------------
+// A font created for a text style.  The charsize and the user char size
+// are kept as the size they give to CreateFont.
+struct CachedFont
+{
+    int font;                   // textInfo.font
+    int direction;              // textInfo.direction
+    int height, width;          // Size of the characters
+    HFONT hFont;
+};
+
+
+// A pen created for a line style and color.  The user pattern is only kept
+// for USERBIT_LINE, and is 0 otherwise.
+struct CachedPen
+{
+    COLORREF color;             // RGB color
+    int linestyle;              // lineInfo.linestyle
+    unsigned upattern;          // lineInfo.upattern
+    int thickness;              // lineInfo.thickness
+    HPEN hPen;
+};
+
+
+// A brush created for a fill style.  The color is the one the brush is made
+// with (the background color for EMPTY_FILL, 0 for the bitmap patterns that
+// take the text color), and the pattern bytes are only kept for USER_FILL.
+struct CachedBrush
+{
+    int pattern;                // fillInfo.pattern
+    COLORREF color;             // RGB color
+    char uPattern[8];           // The user-defined fill style
+    HBRUSH hBrush;
+};
+
+
+// The size of a string in a text style, as measured for textwidth and
+// textheight.  The style is kept the way CachedFont keeps it, since the font
+// for it may only be selected when the recorded drawing is replayed.
+struct CachedExtent
+{
+    int font;                   // textInfo.font, -1 for the stock font
+    int direction;              // textInfo.direction
+    int height, width;          // Size of the characters
+    std::string text;
+    SIZE size;
+};
+
+
+// The calls that can be recorded (record.cxx)
+enum recorded_call
+{
+    REC_ARC, REC_BAR, REC_BAR3D, REC_CIRCLE, REC_CLEARDEVICE, REC_CLEARVIEWPORT,
+    REC_DRAWPOLY, REC_ELLIPSE, REC_FILLELLIPSE, REC_FILLPOLY, REC_FLOODFILL,
+    REC_LINE, REC_LINEREL, REC_LINETO, REC_PIESLICE, REC_PUTPIXEL, REC_PUTPIXELS,
+    REC_RECTANGLE, REC_SECTOR, REC_THICKLINE, REC_PUTIMAGE, REC_MOVEREL, REC_MOVETO,
+    REC_SETBKCOLOR, REC_SETCOLOR, REC_SETLINESTYLE, REC_SETFILLPATTERN,
+    REC_SETFILLSTYLE, REC_SETVIEWPORT, REC_SETWRITEMODE, REC_OUTTEXT,
+    REC_OUTTEXTXY, REC_SETTEXTJUSTIFY, REC_SETTEXTSTYLE, REC_SETUSERCHARSIZE
+};
+
+// Define maximum int arguments of a recorded call
+#define MAX_RECORDED_ARGS 6
+
+// A call recorded while recording is on.  Points, strings and images it
+// was given are copied to WindowData::commandData, starting at data.
+struct DrawCommand
+{
+    recorded_call call;
+    int args[MAX_RECORDED_ARGS];
+    size_t data;
+};
+
+
 // This structure gives all necessary information to the ThreadInitWindow
 // function which creates a new window and processes its messages
 struct WindowData
@@ -41,7 +125,12 @@ struct WindowData
     viewporttype viewportInfo;  // Information about the viewport
     HWND hWnd;                  // Handle to the window created
     HDC hDC[MAX_PAGES];         // Device contexts used for double buffering
-    HBITMAP hOldBitmap[MAX_PAGES]; // The bitmaps generated with CreateCompatibleBitmap
+    HBITMAP hOldBitmap[MAX_PAGES]; // The bitmaps the memory DCs were created with
+    DWORD* pPixels[MAX_PAGES];  // Bits of the 32-bit top-down DIB section behind each page
+    RasterDamage damage[MAX_PAGES]; // What was drawn on each page since it was last cleared (device coordinates)
+    int clearColor[MAX_PAGES];  // RGB color of the last cleardevice of each page, -1 if unknown
+    RasterDamage presented;     // Damage of the page on the screen when it was presented
+    int presentedColor;         // Its clearColor
     int VisualPage;             // The current device context used for painting the window
     int ActivePage;             // The current device context used for drawing
     bool DoubleBuffer;          // Whether the user wants a double buffered window (DOUBLE_BUFFER in initwindow)
@@ -63,12 +152,29 @@ struct WindowData
     PBITMAPINFO pbmpInfo;       // Bitmap header info
     int t_scale[4];		// scaling factor for fonts multx, divx, multy, divy
     UINT alignment;		// current alignment
+    std::vector<CachedFont> fonts; // Fonts created so far, deleted with the window
+    HFONT hFont;                // The font selected into the DCs (NULL for the stock font)
+    bool textStyled;            // True once a text style was set (the DCs have the stock font until then)
+    std::vector<CachedExtent> extents; // Sizes of the strings measured lately
+    std::vector<CachedPen> pens; // Pens created so far, least recently used first
+    std::vector<CachedBrush> brushes; // Brushes created so far, least recently used first
+    HPEN hPen[MAX_PAGES];       // The pen selected into each DC (NULL for a stock pen)
+    HBRUSH hBrush[MAX_PAGES];   // The brush selected into each DC (NULL for a stock brush)
+    bool recording;             // True if drawing is recorded and only replayed by BGI__Flush
+    std::vector<DrawCommand> commands; // The calls recorded since the last replay
+    std::vector<char> commandData; // What those calls were given besides ints
+    size_t nextExtent;          // The entry of extents to replace next
     POINTS mouse;               // Current location of the mouse
     std::queue<POINTS> clicks[WM_MOUSELAST - WM_MOUSEFIRST + 1];   // Array to hold the coordinates of the clicks
     bool mouse_queuing[WM_MOUSELAST - WM_MOUSEFIRST + 1]; // Array to tell whether mouse events should be queued
     Handler mouse_handlers[WM_MOUSELAST - WM_MOUSEFIRST + 1];   // Array of mouse event handlers
     bool refreshing;            // True if autorefershing should be done after each drawing event
     HANDLE hDCMutex;            // A mutex so that only one thread at a time can access the hDC array.
+    std::atomic<DWORD> lockOwner; // Thread that took hDCMutex through BGI__LockDC, 0 if none
+    int lockDepth;              // How many times it did without unlocking, only used by lockOwner
+    bool inFrame;               // True between beginframe and endframe, which keep the lock meanwhile
+    int lockCount;              // Times hDCMutex was taken since the last swapbuffers
+    bool lockStats;             // Print lockCount at each swapbuffers (BGI_LOCKSTATS is set)
 };
 // maybe need current position for lines, text, etc.
 // palette settings
@@ -91,6 +197,11 @@ DWORD WINAPI BGI__ThreadInitWindow( LPVOID pThreadData );
 HDC BGI__GetWinbgiDC( HWND hWnd = NULL );
 void BGI__ReleaseWinbgiDC( HWND hWnd = NULL );
 
+// Takes and releases hDCMutex for the drawing functions.  A thread that
+// holds it already only counts how deep it is in (drawing.cpp)
+void BGI__LockDC( WindowData* pWndData );
+void BGI__UnlockDC( WindowData* pWndData );
+
 // Returns a pointer to the window data structure associated with hWnd.
 // If hWnd is NULL, the current window is used (drawing.cpp)
 WindowData* BGI__GetWindowDataPtr( HWND hWnd = NULL );
@@ -98,6 +209,26 @@ WindowData* BGI__GetWindowDataPtr( HWND hWnd = NULL );
 // Refreshes an area of the window:
 void RefreshWindow( RECT* rect );
 
+// Adds an area (in device coordinates, NULL for all of it) to the damage of
+// the active page (drawing.cpp)
+void BGI__AddDamage( const RECT* rect );
+
+// Invalidates the part of the window that changes when the visual page is
+// shown, rather than all of it (drawing.cpp)
+void BGI__Present( );
+
+// Records a call with count int arguments, and size bytes of data (then
+// moresize more) that are copied, if recording is on.  Returns false if it
+// is off and the call must be done now (record.cxx)
+bool BGI__Record( recorded_call call, const int* args, int count,
+                  const void* data = NULL, size_t size = 0,
+                  const void* more = NULL, size_t moresize = 0 );
+
+// Replays the recorded calls on the active page, under one lock of the
+// DCs.  Anything that reads a page or switches pages calls this first
+// (record.cxx)
+void BGI__Flush( );
+
 // ---------------------------------------------------------------------------
 //                            Global Variables
 // ---------------------------------------------------------------------------
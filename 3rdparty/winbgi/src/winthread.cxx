@@ -44,7 +44,8 @@ DWORD WINAPI BGI__ThreadInitWindow( LPVOID pThreadData )
     HWND hWindow;                       // A handle to the window
     MSG Message;                        // A windows event message
     HDC hDC;                            // The device context of the window
-    HBITMAP hBitmap;                    // A compatible bitmap of the DC for the Memory DC
+    HBITMAP hBitmap;                    // A DIB section of the window size for the Memory DC
+    BITMAPINFO bmi;                     // Format of the DIB sections behind the pages
     HMENU hMenu;                        // Handle to the system menu
     int CaptionHeight, xBorder, yBorder;
 
@@ -117,12 +118,23 @@ DWORD WINAPI BGI__ThreadInitWindow( LPVOID pThreadData )
     // in cls_OnDestroy()
     hDC = GetDC( hWindow );
     pWndData->hDCMutex = CreateMutex(NULL, FALSE,	NULL);
+
+    // The pages are 32-bit top-down DIB sections, so that their pixels can
+    // also be written directly (see putpixels), row y starting at y*width.
+    ZeroMemory( &bmi, sizeof( bmi ) );
+    bmi.bmiHeader.biSize = sizeof( BITMAPINFOHEADER );
+    bmi.bmiHeader.biWidth = pWndData->width;
+    bmi.bmiHeader.biHeight = -pWndData->height;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
     WaitForSingleObject(pWndData->hDCMutex, 5000);
     for ( int i = 0; i < MAX_PAGES; i++ )
     {
         pWndData->hDC[i] = CreateCompatibleDC( hDC );
         // Create a bitmap for the memory DC.  This is where the drawn image is stored.
-        hBitmap = CreateCompatibleBitmap( hDC, pWndData->width, pWndData->height );
+        hBitmap = CreateDIBSection( hDC, &bmi, DIB_RGB_COLORS, (void**)&pWndData->pPixels[i], NULL, 0 );
         pWndData->hOldBitmap[i] = (HBITMAP)SelectObject( pWndData->hDC[i], hBitmap );
     }
     ReleaseMutex(pWndData->hDCMutex);
@@ -185,11 +197,11 @@ static void cls_OnDestroy( HWND hWnd )
     WaitForSingleObject(pWndData->hDCMutex, 5000);
     for ( int i = 0; i < MAX_PAGES; i++ )
     {
-        // Delete the pen in the DC's
-        DeletePen( SelectPen( pWndData->hDC[i], GetStockPen( WHITE_PEN ) ) );
-
-        // Delete the brush in the DC's
-        DeleteBrush( SelectBrush( pWndData->hDC[i], GetStockBrush( WHITE_BRUSH ) ) );
+        // Select stock objects, so the cached pen and brush can be deleted
+        SelectPen( pWndData->hDC[i], GetStockPen( WHITE_PEN ) );
+        SelectBrush( pWndData->hDC[i], GetStockBrush( WHITE_BRUSH ) );
+        pWndData->hPen[i] = NULL;
+        pWndData->hBrush[i] = NULL;
 
         // Here we clean up the memory device contexts used by the program.
         // This selects the original bitmap back into the memory DC.  The SelectObject
@@ -198,6 +210,16 @@ static void cls_OnDestroy( HWND hWnd )
         // Finally, we delete the MemoryDC
         DeleteObject( pWndData->hDC[i] );
     }
+    // With the DCs gone, none of the fonts, pens or brushes is selected anymore
+    for ( size_t i = 0; i < pWndData->fonts.size( ); i++ )
+        DeleteObject( pWndData->fonts[i].hFont );
+    pWndData->fonts.clear( );
+    for ( size_t i = 0; i < pWndData->pens.size( ); i++ )
+        DeletePen( pWndData->pens[i].hPen );
+    pWndData->pens.clear( );
+    for ( size_t i = 0; i < pWndData->brushes.size( ); i++ )
+        DeleteBrush( pWndData->brushes[i].hBrush );
+    pWndData->brushes.clear( );
     ReleaseMutex(pWndData->hDCMutex);
     // Clean up the bitmap memory
     DeleteBitmap( pWndData->hbitmap );
@@ -320,8 +342,13 @@ static void cls_OnPaint( HWND hWnd )
     POINT srcCorner;            // Logical coordinates of the source image upper left point
     BOOL success;               // Is the BitBlt successful?
     int i;                      // Count for how many bitblts have been tried.
+    HRGN hRgn;                  // The region that needs to be redrawn
+    int kind;                   // What kind of region it is
 
     WaitForSingleObject(pWndData->hDCMutex, INFINITE);
+    // Get the update region before BeginPaint validates it
+    hRgn = CreateRectRgn( 0, 0, 0, 0 );
+    kind = GetUpdateRgn( hWnd, hRgn, FALSE );
     BeginPaint( hWnd, &ps );
 
     hSrcDC = pWndData->hDC[pWndData->VisualPage];   // The source (memory) DC
@@ -340,11 +367,28 @@ static void cls_OnPaint( HWND hWnd )
     //DPtoLP( hSrcDC, &srcCorner, 1 );
 
     // MGM: Screen BitBlts are not always successful, although I don't know why.
-    success = BitBlt( ps.hdc, ps.rcPaint.left, ps.rcPaint.top, width, height,
+    if ( kind == COMPLEXREGION )
+    {
+	// Several rectangles were invalidated (see BGI__Present).  Copy each
+	// of them rather than the box around all of them.
+	DWORD size = GetRegionData( hRgn, 0, NULL );
+	std::vector<char> buffer( size );
+	RGNDATA* pData = (RGNDATA*)&buffer[0];
+	RECT* pRects = (RECT*)pData->Buffer;
+
+	success = GetRegionData( hRgn, size, pData ) != 0;
+	for ( DWORD r = 0; success && r < pData->rdh.nCount; r++ )
+	    success = BitBlt( ps.hdc, pRects[r].left, pRects[r].top,
+			      pRects[r].right - pRects[r].left, pRects[r].bottom - pRects[r].top,
+			      hSrcDC, pRects[r].left, pRects[r].top, SRCCOPY );
+    }
+    else
+	success = BitBlt( ps.hdc, ps.rcPaint.left, ps.rcPaint.top, width, height,
 			 hSrcDC, srcCorner.x, srcCorner.y, SRCCOPY );
 
     EndPaint( hWnd, &ps );  // Validates the rectangle
     ReleaseMutex(pWndData->hDCMutex);
+    DeleteObject( hRgn );
 
     if ( !success )
     {   // I would like to invalidate the rectangle again
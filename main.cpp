@@ -1,7 +1,17 @@
 #include <graphics.h>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstring>
 #include <ctime>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
+#if defined(BatchStats) || defined(QualityStats) || defined(StarStats)
+#include <iostream>
+#endif
 
 static constexpr double pi = 3.141592653589;
 static const int DelayTime = 10;
@@ -12,8 +22,17 @@ static constexpr int ScreenHalfWidth = ScreenWidth/2;
 static constexpr int ScreenHalfHeight = ScreenHeight/2;
 static constexpr double SHHx075 = ScreenHalfHeight*0.75;
 static const double Diagonal = sqrt(ScreenWidth*ScreenWidth + ScreenHeight*ScreenHeight);
-static const double cos0_0005 = cos(0.0005);
-static const double sin0_0005 = sin(0.0005);
+static const int MaxBulls = 7;
+static const int MaxTurrets = 4;
+static const int MaxLasers = 2;
+// Headings the hulls are drawn at once at startup (see SpriteAtlas): the more,
+// the finer they turn and the more memory they take, about 115 KB per heading
+// for all four hulls. With 0 their polygons are filled every frame instead.
+static const int SpriteHeadings = 256;
+// Frames per second the render thread draws, in between the ticks too: the
+// ship, the enemies and the bullets are then shown part of the way between the
+// last two snapshots. With 0 every snapshot is drawn once, as it comes.
+static const int RenderRate = 144;
 static char sPlay[] = "Play";
 static char sQuit[] = "Quit";
 static char sResume[] = "Resume";
@@ -57,7 +76,12 @@ enum GameState{GameEnded, GameInProcess, GamePaused, GameRestarting, LoseProcess
 static bool menuProcess(int EndGameState);
 static int pauseProcess();
 static int loseProcess();
-static void DrawGui(double Health, double Time, int Energy, double EnergyGraph[30], unsigned int Kills, double k, bool LoseBulb);
+struct GuiLook;
+static void TrackGui(GuiLook & Gui, double Health, double Time, int Energy, double EnergyGraph[30], unsigned int Kills, double k, bool LoseBulb);
+class DrawBatch;
+static void DrawGui(DrawBatch & Batch, const GuiLook & Gui);
+class GuiChrome;
+static GuiChrome & Chrome();
 static void ClearInput();
 static char * numberToString(unsigned int Num, char * Str);
 static char * numberToString(double Num, char * Str, unsigned int precision);
@@ -76,6 +100,7 @@ struct Point
 	}
 
 	Point() = default;
+	constexpr Point(double x_, double y_): x(x_), y(y_){}
 	Point(Point & Data): x(Data.x), y(Data.y){}
 };
 
@@ -113,17 +138,21 @@ private:
 	void DeleteNode(Node * NodeForDeletion);
 
 public:
-	operator=(List &) = delete;
-	operator=(List &&) = delete;
+	List & operator=(List &) = delete;
+	List & operator=(List &&) = delete;
 	List(List &) = delete;
 	List(List &&) = delete;
 
 	List(): First(nullptr), Last(nullptr){}
 	void CreateNode(T && Data);
+	void CreateNode(T && Data, bool (*Before)(T & Data1, T & Data2));
 	void ForEach(void (*Action)(T & Data));
 	unsigned int CountIf(bool (*Check)(T & Data));
 	void CheckForDelete(bool (*Check)(T & Data));
 	unsigned int DeleteAndCount(bool (*Check)(T & Data));
+	template<typename... Types>
+	unsigned int DeleteAndCount(Types&... Args, bool (*Check)(Types&... Args, T & Data));
+	unsigned int DeleteFirstWhile(bool (*Check)(T & Data));
 	Node * GetFirstPtr(){return First;}
 	template<typename T2>
 	void CompareWith(List<T2> & List2, void(*Action)(T & Data1, T2 & Data2));
@@ -146,6 +175,25 @@ void List<T>::CreateNode(T && Data)
 		First = Last = new Node(Data);
 }
 
+template<typename T>
+void List<T>::CreateNode(T && Data, bool (*Before)(T & Data1, T & Data2))
+{
+	Node * Next = nullptr;
+	for(Node * i = Last; i && Before(Data, i->Data); i = i->PrevNode)
+		Next = i;
+	if(!Next)
+		return CreateNode(static_cast<T &&>(Data));
+
+	Node * NewNode = new Node(Data);
+	NewNode->PrevNode = Next->PrevNode;
+	NewNode->NextNode = Next;
+	if(Next->PrevNode)
+		Next->PrevNode->NextNode = NewNode;
+	else
+		First = NewNode;
+	Next->PrevNode = NewNode;
+}
+
 template<typename T>
 void List<T>::DeleteNode(Node * NodeForDeletion)
 {
@@ -197,12 +245,46 @@ template<typename T>
 unsigned int List<T>::DeleteAndCount(bool (*Check)(T & Data))
 {
 	unsigned int Count = 0;
-	for(Node * i = First; i; i = i->NextNode)
+	Node * Temp;
+	for(Node * i = First; i; i = Temp)
+	{
+		Temp = i->NextNode;
 		if(Check(i->Data))
 		{
 			DeleteNode(i);
 			Count++;
 		}
+	}
+	return Count;
+}
+
+template<typename T>
+template<typename... Types>
+unsigned int List<T>::DeleteAndCount(Types&... Args, bool (*Check)(Types&... Args, T & Data))
+{
+	unsigned int Count = 0;
+	Node * Temp;
+	for(Node * i = First; i; i = Temp)
+	{
+		Temp = i->NextNode;
+		if(Check(Args..., i->Data))
+		{
+			DeleteNode(i);
+			Count++;
+		}
+	}
+	return Count;
+}
+
+template<typename T>
+unsigned int List<T>::DeleteFirstWhile(bool (*Check)(T & Data))
+{
+	unsigned int Count = 0;
+	while(First && Check(First->Data))
+	{
+		DeleteNode(First);
+		Count++;
+	}
 	return Count;
 }
 
@@ -242,20 +324,38 @@ List<T>::~List<T>()
 	}
 }
 
+class Particles;
+
 class BulletsArray
 {
+private:
+
+	static unsigned int Tick;
+
 public:
 
 	struct Bullet
 	{
-		Point BulletDot;
-		Point Tail;
-		double Angle;
-		enum{DeleteNow = 5};
-		int Deletion;
+		float x, y;
+		float dx, dy;
+		float Tail;
+		unsigned int Spawn;
+		unsigned int Expire;
+		bool Hit;
+		static constexpr double Length = 30.0;
+
+		Bullet(double x_, double y_, double Angle, double Speed);
+		void GetHead(float & hx, float & hy){float t = Tick - Spawn + Tail; hx = x + dx*t, hy = y + dy*t;}
+		void GetTail(float & tx, float & ty){float t = Tick - Spawn; tx = x + dx*t, ty = y + dy*t;}
+		void Stop(){Hit = true;}
+	};
 
-		Bullet(double x, double y, double Angle_): Angle(Angle_), Deletion(0){BulletDot.SetDots(x,y), BulletDot.MovePoint(Angle_, 15.0), Tail.SetDots(x,y);}
-		Bullet(Bullet & Data): Angle(Data.Angle), Deletion(Data.Deletion){BulletDot.SetDots(Data.BulletDot.x, Data.BulletDot.y), BulletDot.MovePoint(Angle, 15.0), Tail.SetDots(Data.Tail.x, Data.Tail.y);}
+	// What a frame shows of a bullet, and how far it moves in a tick
+	struct BulletLook
+	{
+		float Tailx, Taily;
+		float Headx, Heady;
+		float dx, dy;
 	};
 
 private:
@@ -270,102 +370,545 @@ public:
 
 	BulletsArray(int r, int g, int b, double Speed_, int Thickness_ = 1): Thickness(Thickness_), Speed(Speed_){Color[0] = r, Color[1] = g, Color[2] = b;}
 	List<Bullet> & GetBulletsList(){return Bullets;}
-	void CreateBullet(double x, double y, double Angle){Bullets.CreateNode(Bullet(x, y, Angle));}
-	void MoveBullets();
-	void DrawBullets();
+	void CreateBullet(double x, double y, double Angle){Bullets.CreateNode(Bullet(x, y, Angle, Speed), [](Bullet & New, Bullet & Old){return New.Expire < Old.Expire;});}
+	static void MoveBullets(){Tick++;}
+	void GetLooks(std::vector<BulletLook> & Looks);
+	void DrawBullets(const std::vector<BulletLook> & Looks) const;
 	void CheckForDeletion();
+	void RemoveHits(Particles & Effects);
 	void DeleteAll(){Bullets.Clear();}
 };
 
+unsigned int BulletsArray::Tick = 1;
+
+// A bullet that moves along an axis only by rounding error, like a vertical
+// shot whose cosine is not quite zero, would leave through that side after
+// far more ticks than an unsigned int holds, so ages are capped first.
+static const unsigned int MaxBulletAge = 1u << 20;
+
+static inline unsigned int ExitAge(float From, float Step, float Low, float High)
+{
+	if(Step > 0.0f)
+		return min(max((High - From)/Step, 0.0f), float(MaxBulletAge)) + 1;
+	if(Step < 0.0f)
+		return min(max((Low - From)/Step, 0.0f), float(MaxBulletAge)) + 1;
+	return MaxBulletAge + 1;
+}
+
+BulletsArray::Bullet::Bullet(double x_, double y_, double Angle, double Speed): x(x_), y(y_), dx(fcos(Angle)*Speed), dy(fsin(-Angle)*Speed), Tail(Length/Speed), Spawn(Tick), Hit(false)
+{
+	Expire = Spawn + min(ExitAge(x, dx, -200, ScreenWidth + 200), ExitAge(y, dy, -200, ScreenHeight + 200));
+}
+
 void BulletsArray::CheckForDeletion()
 {
-	Bullets.CheckForDelete([](Bullet & Data){return Data.Deletion == Bullet::DeleteNow;});
+	Bullets.DeleteFirstWhile([](Bullet & Data){return Data.Expire <= Tick;});
 }
 
-void BulletsArray::MoveBullets()
+// The vector keeps its memory from frame to frame, so this allocates only
+// when there are more bullets than ever before.
+void BulletsArray::GetLooks(std::vector<BulletLook> & Looks)
 {
-	void (*Action)(double &, Bullet &) = [](double & Speed, Bullet & Data)
-																		{
-																			if(!Data.Deletion)
-																			{
-																				Data.BulletDot.MovePoint(Data.Angle, Speed);
-																				Data.Tail.MovePoint(Data.Angle, Speed);
-																			}
-																			else
-																			{
-																				Data.Deletion++;
-																				Data.Tail.MovePoint(Data.Angle, Speed/1.5);
-																			}
-																				if(Data.Tail.x < -200 || Data.Tail.x > ScreenWidth + 200 || Data.Tail.y < -200 || Data.Tail.y > ScreenHeight + 200)
-																					Data.Deletion = 5;
-																		};
-	Bullets.CompareWith<double>(Speed, Action);
+	BulletLook Look;
+	Looks.clear();
+	for(auto i = Bullets.GetFirstPtr(); i; i = i->NextNode)
+	{
+		i->Data.GetHead(Look.Headx, Look.Heady);
+		i->Data.GetTail(Look.Tailx, Look.Taily);
+		Look.dx = i->Data.dx, Look.dy = i->Data.dy;
+		Looks.push_back(Look);
+	}
 }
 
-void BulletsArray::DrawBullets()
+void BulletsArray::DrawBullets(const std::vector<BulletLook> & Looks) const
 {
 	setcolor(COLOR(Color[0], Color[1], Color[2]));
-	setfillstyle(SOLID_FILL, COLOR(Color[0], Color[1], Color[2]));
-	void (*Action)(int &, Bullet &) = [](int & Thickness, Bullet & Data)
+	for(const BulletLook & Data : Looks)
+		thickline(Data.Tailx, Data.Taily, Data.Headx, Data.Heady, Thickness);
+}
+
+// The hull of an archetype drawn beforehand at every one of SpriteHeadings
+// headings, so that a frame puts an image of it instead of filling its
+// polygon. As with the HUD chrome, a heading has a mask put with AND_PUT (the
+// hull over white) and an image put with OR_PUT (the hull over black): ANDing
+// the hull colors and ORing them again leaves just them, while white and black
+// leave the page alone. The images are square, the hull centered in them.
+class SpriteAtlas
+{
+private:
+
+	int Half;
+	unsigned int Size;
+	std::vector<char> Masks, Images;
+
+	void Capture(std::vector<char> & Buffers, int Background, int Count, const Point * Dots, int Color, int Fill);
+
+public:
+
+	SpriteAtlas(int Count, const Point * Dots, int Color, int Fill);
+	SpriteAtlas(SpriteAtlas &) = delete;
+	SpriteAtlas & operator=(SpriteAtlas &) = delete;
+	int GetHalf() const{return Half;}
+	static int GetHeading(double Angle);
+	void Draw(int x, int y, int Heading) const;
+};
+
+SpriteAtlas::SpriteAtlas(int Count, const Point * Dots, int Color, int Fill): Half(0), Size(0)
+{
+	if(!SpriteHeadings)
+		return;
+	for(int i = 0; i < Count; i++)
+		Half = max(Half, static_cast<int>(ceil(hypot(Dots[i].x, Dots[i].y))) + 1);
+	Size = imagesize(0, 0, 2*Half, 2*Half);
+
+	const int ActivePage = getactivepage();
+	setactivepage(2);
+	Capture(Masks, WHITE, Count, Dots, Color, Fill);
+	Capture(Images, BLACK, Count, Dots, Color, Fill);
+	setactivepage(ActivePage);
+}
+
+// The hull is turned the way DrawEnemy turns it, around the middle of the
+// center pixel, so that truncating the dots rounds them.
+void SpriteAtlas::Capture(std::vector<char> & Buffers, int Background, int Count, const Point * Dots, int Color, int Fill)
+{
+	std::vector<int> DotsBuf(Count*2);
+	Buffers.resize(static_cast<size_t>(Size)*SpriteHeadings);
+	for(int k = 0; k < SpriteHeadings; k++)
+	{
+		const double Angle = 2.0*pi*k/SpriteHeadings;
+		for(int i = 0; i < Count; i++)
+		{
+			DotsBuf[i*2] = Dots[i].x*fcos(Angle) - Dots[i].y*fsin(-Angle) + Half + 0.5;
+			DotsBuf[i*2 + 1] = Dots[i].x*fsin(-Angle) + Dots[i].y*fcos(Angle) + Half + 0.5;
+		}
+		setfillstyle(SOLID_FILL, Background);
+		bar(0, 0, 2*Half + 1, 2*Half + 1);
+		setfillstyle(SOLID_FILL, Fill);
+		setcolor(Color);
+		fillpoly(Count, DotsBuf.data());
+		getimage(0, 0, 2*Half, 2*Half, &Buffers[static_cast<size_t>(Size)*k]);
+	}
+}
+
+int SpriteAtlas::GetHeading(double Angle)
+{
+	double Turns = fmod(Angle/(2.0*pi), 1.0);
+	if(Turns < 0.0)
+		Turns += 1.0;
+	return static_cast<int>(Turns*SpriteHeadings + 0.5) % SpriteHeadings;
+}
+
+void SpriteAtlas::Draw(int x, int y, int Heading) const
+{
+	const size_t At = static_cast<size_t>(Size)*Heading;
+	putimage(x - Half, y - Half, const_cast<char *>(&Masks[At]), AND_PUT);
+	putimage(x - Half, y - Half, const_cast<char *>(&Images[At]), OR_PUT);
+}
+
+// Collects the filled shapes of a layer and draws them grouped by their
+// colors, so the outline color and the fill style are set once per group
+// instead of once per shape. A shape is only drawn ahead of shapes queued
+// before it when their bounds don't meet, so whatever overlaps still ends up
+// in the order it was queued. Sprites take no colors and go with any. Which
+// shapes meet is worked out once per flush, so a flush costs at most a test
+// per pair of shapes and a look at every shape left per pass. With
+// BatchStats defined, every frame prints how many colors the shapes would have
+// set one by one, and how many were set.
+class DrawBatch
+{
+private:
+
+	enum{MaxDots = 10, AnyColor = -1};
+
+	struct Shape
+	{
+		enum{Poly, Bar, Ellipse, Line, Sprite} Kind;
+		int Color, Fill;
+		const SpriteAtlas * Atlas;
+		int Left, Top, Right, Bottom;
+		int Count;
+		int Dots[MaxDots*2];
+	};
+
+	std::vector<Shape> Shapes;
+	std::vector<char> Drawn;
+	std::vector<int> Blockers;				// Shapes queued before and not drawn yet that meet it
+	std::vector<unsigned int> Later, LaterFirst;	// Shapes queued after that meet it, from LaterFirst[i] to LaterFirst[i + 1]
+	int Color, Fill;
+	unsigned int Queued, Made;
+
+	static bool Meet(const Shape & a, const Shape & b){return a.Left <= b.Right && b.Left <= a.Right && a.Top <= b.Bottom && b.Top <= a.Bottom;}
+	bool Current(const Shape & Data){return (Data.Fill == AnyColor || Data.Fill == Fill) && (Data.Color == AnyColor || Data.Color == Color);}
+	void SetState(const Shape & Data);
+	void DrawShape(const Shape & Data);
+
+public:
+
+	DrawBatch(): Queued(0), Made(0){}
+	void FillPoly(int Count, const int * Dots, int Color_, int Fill_);
+	void Bar(int Left, int Top, int Right, int Bottom, int Fill_);
+	void FillEllipse(int x, int y, int xRadius, int yRadius, int Color_, int Fill_);
+	void ThickLine(int x1, int y1, int x2, int y2, int Thickness, int Color_);
+	void Sprite(const SpriteAtlas & Atlas, double x, double y, double Angle);
+	void Flush();
+	void Report();
+};
+
+// The bounds take in the outline, and a pixel more for rounding.
+void DrawBatch::FillPoly(int Count, const int * Dots, int Color_, int Fill_)
+{
+	Shape New;
+	New.Kind = Shape::Poly;
+	New.Color = Color_, New.Fill = Fill_;
+	New.Count = Count;
+	New.Left = New.Right = Dots[0], New.Top = New.Bottom = Dots[1];
+	for(int i = 0; i < Count; i++)
+	{
+		New.Dots[i*2] = Dots[i*2], New.Dots[i*2 + 1] = Dots[i*2 + 1];
+		New.Left = min(New.Left, Dots[i*2]), New.Right = max(New.Right, Dots[i*2]);
+		New.Top = min(New.Top, Dots[i*2 + 1]), New.Bottom = max(New.Bottom, Dots[i*2 + 1]);
+	}
+	New.Left -= 2, New.Top -= 2, New.Right += 2, New.Bottom += 2;
+	Shapes.push_back(New);
+}
+
+// A bar has no outline, so it takes whatever color is set.
+void DrawBatch::Bar(int Left, int Top, int Right, int Bottom, int Fill_)
+{
+	Shape New;
+	New.Kind = Shape::Bar;
+	New.Color = AnyColor, New.Fill = Fill_;
+	New.Count = 0;
+	New.Dots[0] = Left, New.Dots[1] = Top, New.Dots[2] = Right, New.Dots[3] = Bottom;
+	New.Left = min(Left, Right) - 1, New.Right = max(Left, Right) + 1;
+	New.Top = min(Top, Bottom) - 1, New.Bottom = max(Top, Bottom) + 1;
+	Shapes.push_back(New);
+}
+
+void DrawBatch::FillEllipse(int x, int y, int xRadius, int yRadius, int Color_, int Fill_)
+{
+	Shape New;
+	New.Kind = Shape::Ellipse;
+	New.Color = Color_, New.Fill = Fill_;
+	New.Count = 0;
+	New.Dots[0] = x, New.Dots[1] = y, New.Dots[2] = xRadius, New.Dots[3] = yRadius;
+	New.Left = x - xRadius - 2, New.Right = x + xRadius + 2;
+	New.Top = y - yRadius - 2, New.Bottom = y + yRadius + 2;
+	Shapes.push_back(New);
+}
+
+// A line has no fill, so it takes whatever fill is set.
+void DrawBatch::ThickLine(int x1, int y1, int x2, int y2, int Thickness, int Color_)
+{
+	Shape New;
+	New.Kind = Shape::Line;
+	New.Color = Color_, New.Fill = AnyColor;
+	New.Count = Thickness;
+	New.Dots[0] = x1, New.Dots[1] = y1, New.Dots[2] = x2, New.Dots[3] = y2;
+	New.Left = min(x1, x2) - Thickness/2 - 2, New.Right = max(x1, x2) + Thickness/2 + 2;
+	New.Top = min(y1, y2) - Thickness/2 - 2, New.Bottom = max(y1, y2) + Thickness/2 + 2;
+	Shapes.push_back(New);
+}
+
+void DrawBatch::Sprite(const SpriteAtlas & Atlas, double x, double y, double Angle)
+{
+	Shape New;
+	New.Kind = Shape::Sprite;
+	New.Color = New.Fill = AnyColor;
+	New.Atlas = &Atlas;
+	New.Count = 0;
+	New.Dots[0] = floor(x), New.Dots[1] = floor(y), New.Dots[2] = SpriteAtlas::GetHeading(Angle);
+	New.Left = New.Dots[0] - Atlas.GetHalf(), New.Right = New.Dots[0] + Atlas.GetHalf();
+	New.Top = New.Dots[1] - Atlas.GetHalf(), New.Bottom = New.Dots[1] + Atlas.GetHalf();
+	Shapes.push_back(New);
+}
+
+void DrawBatch::SetState(const Shape & Data)
+{
+	if(Data.Fill != AnyColor && Data.Fill != Fill)
+	{
+		setfillstyle(SOLID_FILL, Fill = Data.Fill);
+		Made++;
+	}
+	if(Data.Color != AnyColor && Data.Color != Color)
+	{
+		setcolor(Color = Data.Color);
+		Made++;
+	}
+}
+
+void DrawBatch::DrawShape(const Shape & Data)
+{
+	switch(Data.Kind)
+	{
+	case Shape::Poly:
+		fillpoly(Data.Count, const_cast<int *>(Data.Dots));
+		break;
+	case Shape::Bar:
+		bar(Data.Dots[0], Data.Dots[1], Data.Dots[2], Data.Dots[3]);
+		break;
+	case Shape::Ellipse:
+		fillellipse(Data.Dots[0], Data.Dots[1], Data.Dots[2], Data.Dots[3]);
+		break;
+	case Shape::Line:
+		thickline(Data.Dots[0], Data.Dots[1], Data.Dots[2], Data.Dots[3], Data.Count);
+		break;
+	case Shape::Sprite:
+		Data.Atlas->Draw(Data.Dots[0], Data.Dots[1], Data.Dots[2]);
+		break;
+	}
+}
+
+// Every pass draws, in order, what can be drawn with the colors set. When
+// nothing can, the first shape left takes its colors: nothing queued before it
+// is left, so it can always be drawn. The colors set before the flush are not
+// known, so the first shape always sets them. A shape drawn frees the later
+// ones it meets, which the rest of the same pass can then draw.
+void DrawBatch::Flush()
+{
+	const size_t Count = Shapes.size();
+	for(const Shape & Data : Shapes)
+		Queued += (Data.Fill != AnyColor) + (Data.Color != AnyColor);
+
+	Drawn.assign(Count, false);
+	Blockers.assign(Count, 0);
+	Later.clear();
+	LaterFirst.resize(Count + 1);
+	for(size_t i = 0; i < Count; i++)
+	{
+		LaterFirst[i] = Later.size();
+		for(size_t j = i + 1; j < Count; j++)
+			if(Meet(Shapes[i], Shapes[j]))
+			{
+				Later.push_back(j);
+				Blockers[j]++;
+			}
+	}
+	LaterFirst[Count] = Later.size();
+
+	Color = Fill = AnyColor;
+	size_t First = 0;
+	while(First < Count)
+	{
+		bool Any = false;
+		for(size_t i = First; i < Count; i++)
+			if(!Drawn[i] && !Blockers[i] && Current(Shapes[i]))
+			{
+				DrawShape(Shapes[i]);
+				Drawn[i] = Any = true;
+				for(size_t k = LaterFirst[i]; k < LaterFirst[i + 1]; k++)
+					Blockers[Later[k]]--;
+			}
+		if(!Any)
+			SetState(Shapes[First]);
+		while(First < Count && Drawn[First])
+			First++;
+	}
+	Shapes.clear();
+}
+
+void DrawBatch::Report()
+{
+	#ifdef BatchStats
+	std::cout << "color changes: " << Queued << " queued, " << Made << " made" << std::endl;
+	#endif
+	Queued = Made = 0;
+}
+
+// Explosions and bullet impacts. They live here rather than with the enemies
+// and bullets they come from, so those leave the game as soon as they die or
+// hit, and nothing that moves or collides has to step over them. The pool has
+// a fixed capacity and keeps every field in an array of its own; a particle
+// that burns out is replaced by the last one, and one spawned when the pool is
+// full is dropped.
+//
+// A particle is a disk that grows by Grow every tick it ages, and, when it has
+// a Thickness, a line to the disk from a tail that moves by Vx, Vy per tick.
+// It is shown while its Age is at most Life.
+class Particles
+{
+public:
+
+	enum{Under, Impacts, Over};	// Layers, drawn below the ship, above the bullets and above the HUD
+	enum{WreckLife = 9, BlowUpLife = 14, BlastGrowth = 3, ImpactLife = 4};
+
+private:
+
+	enum{Capacity = 256};
+
+	int Count;
+	float Headx[Capacity], Heady[Capacity];
+	float Tailx[Capacity], Taily[Capacity];
+	float Vx[Capacity], Vy[Capacity];
+	int Grow[Capacity], Thickness[Capacity];
+	int Color[Capacity], Fill[Capacity];
+	int Age[Capacity], Life[Capacity];
+	int Layer[Capacity];
+
+	int Spawn(int Layer_, int Life_, int Age_);
+
+public:
+
+	Particles(): Count(0){}
+	void Blast(double x, double y, int Layer_, int Life_, int Color_, int Fill_, int Age_ = 1);
+	void Impact(float hx, float hy, float tx, float ty, float vx, float vy, int Thickness_, int Color_);
+	void Update();
+	void Clear(){Count = 0;}
+	void CopyTo(Particles & To) const;
+	void Draw(DrawBatch & Batch, int Layer_, int Detail = 2) const;
+};
+
+int Particles::Spawn(int Layer_, int Life_, int Age_)
+{
+	if(Count == Capacity)
+		return -1;
+	Layer[Count] = Layer_, Life[Count] = Life_, Age[Count] = Age_;
+	return Count++;
+}
+
+void Particles::Blast(double x, double y, int Layer_, int Life_, int Color_, int Fill_, int Age_)
+{
+	int i = Spawn(Layer_, Life_, Age_);
+	if(i < 0)
+		return;
+	Headx[i] = x, Heady[i] = y;
+	Grow[i] = BlastGrowth, Thickness[i] = 0;
+	Color[i] = Color_, Fill[i] = Fill_;
+}
+
+// The disk grows by the thickness of the line, but never faster than by 4.
+void Particles::Impact(float hx, float hy, float tx, float ty, float vx, float vy, int Thickness_, int Color_)
+{
+	int i = Spawn(Impacts, ImpactLife, 1);
+	if(i < 0)
+		return;
+	Headx[i] = hx, Heady[i] = hy;
+	Tailx[i] = tx, Taily[i] = ty;
+	Vx[i] = vx, Vy[i] = vy;
+	Grow[i] = min(Thickness_, 4), Thickness[i] = Thickness_;
+	Color[i] = Fill[i] = Color_;
+}
+
+void Particles::Update()
+{
+	for(int i = 0; i < Count; )
+		if(++Age[i] > Life[i])
+		{
+			Count--;
+			Headx[i] = Headx[Count], Heady[i] = Heady[Count];
+			Tailx[i] = Tailx[Count], Taily[i] = Taily[Count];
+			Vx[i] = Vx[Count], Vy[i] = Vy[Count];
+			Grow[i] = Grow[Count], Thickness[i] = Thickness[Count];
+			Color[i] = Color[Count], Fill[i] = Fill[Count];
+			Age[i] = Age[Count], Life[i] = Life[Count];
+			Layer[i] = Layer[Count];
+		}
+		else
+			i++;
+}
+
+// Only the live particles are copied, which is what a snapshot needs.
+void Particles::CopyTo(Particles & To) const
+{
+	To.Count = Count;
+	std::copy(Headx, Headx + Count, To.Headx), std::copy(Heady, Heady + Count, To.Heady);
+	std::copy(Tailx, Tailx + Count, To.Tailx), std::copy(Taily, Taily + Count, To.Taily);
+	std::copy(Vx, Vx + Count, To.Vx), std::copy(Vy, Vy + Count, To.Vy);
+	std::copy(Grow, Grow + Count, To.Grow), std::copy(Thickness, Thickness + Count, To.Thickness);
+	std::copy(Color, Color + Count, To.Color), std::copy(Fill, Fill + Count, To.Fill);
+	std::copy(Age, Age + Count, To.Age), std::copy(Life, Life + Count, To.Life);
+	std::copy(Layer, Layer + Count, To.Layer);
+}
+
+// Detail 1 leaves out the tails of the impacts, and 0 the impacts themselves.
+void Particles::Draw(DrawBatch & Batch, int Layer_, int Detail) const
+{
+	for(int i = 0; i < Count; i++)
+		if(Layer[i] == Layer_ && (Detail || !Thickness[i]))
+		{
+			if(Thickness[i] && Detail > 1)
+				Batch.ThickLine(Tailx[i] + Vx[i]*(Age[i] - 1), Taily[i] + Vy[i]*(Age[i] - 1), Headx[i], Heady[i], Thickness[i], Color[i]);
+			Batch.FillEllipse(Headx[i], Heady[i], Age[i]*Grow[i], Age[i]*Grow[i], Color[i], Fill[i]);
+		}
+}
+
+// A bullet that hit something leaves at once, and what is left of it fades
+// out in Effects: its tail keeps moving at two thirds of its speed into the
+// disk growing at its head.
+void BulletsArray::RemoveHits(Particles & Effects)
+{
+	bool (*Check)(Particles &, BulletsArray &, Bullet &) = [](Particles & Effects, BulletsArray & Array, Bullet & Data)
 																		{
-																			setlinestyle(SOLID_LINE, 0, Thickness);
-																			moveto(Data.Tail.x, Data.Tail.y);
-																			lineto(Data.BulletDot.x, Data.BulletDot.y);
-																			setlinestyle(SOLID_LINE, 0, 1);
-																			if(Data.Deletion)
-																				fillellipse(Data.BulletDot.x, Data.BulletDot.y, Data.Deletion*(Thickness > 4? 4: Thickness), Data.Deletion*(Thickness > 4? 4: Thickness));
+																			if(!Data.Hit)
+																				return false;
+																			float hx, hy, tx, ty;
+																			Data.GetHead(hx, hy);
+																			Data.GetTail(tx, ty);
+																			Effects.Impact(hx, hy, tx, ty, Data.dx/1.5f, Data.dy/1.5f, Array.Thickness, COLOR(Array.Color[0], Array.Color[1], Array.Color[2]));
+																			return true;
 																		};
-	Bullets.CompareWith<int>(Thickness, Action);
+	Bullets.DeleteAndCount<Particles, BulletsArray>(Effects, *this, Check);
 }
 
 class Ship;
 
-template<int DotsCount, int ControlDots, typename... DoActionTypes>
+template<class Model, typename... DoActionTypes>
 class Enemy
 {
 protected:
 
 	Point Center;
 	double Angle;
-	Point Dots[DotsCount];
-	unsigned int Shape[ControlDots];
 	int CoolDown;
 	double Health;
 	int State;
 	enum{Left, Right, Up, Down};
-	int Dead;
 	double Damage;
+	unsigned int Id;
+	static unsigned int Spawned;
 
 	void MoveEnemy(double Speed);
-	virtual void DrawHealthBar() = 0;
 
 public:
 
-	enum{DeadRightNow = 10};
+	// What a frame shows of an enemy. Enemies of a kind get increasing Ids as
+	// they spawn, and keep their order in the list, so the looks of two frames
+	// are in the order of their Ids.
+	struct Look
+	{
+		double x, y;
+		double Angle;
+		double Health;
+		unsigned int Id;
+	};
 
 	Enemy();
 	Enemy(Enemy & Data);
 	virtual void DoAction(DoActionTypes... PassedData) = 0;
 	void TakeDamage(){Health = max(Health - Damage, 0.0);}
 	void TakeDamage(double HowMany){Health = max(Health - HowMany, 0.0);}
-	void DrawEnemy();
+	Look GetLook(){return {Center.x, Center.y, Angle, Health, Id};}
+	static int HealthColor(double Health){return COLOR(255 * min((100.0 - Health)/50.0, 1.0), 255 * min(Health/50.0, 1.0), 0);}
+	static const SpriteAtlas & Hull(){static const SpriteAtlas Atlas(Model::DotsCount, Model::Dots, COLOR(255, 0, 0), COLOR(128, 0, 0)); return Atlas;}
+	static void DrawEnemy(DrawBatch & Batch, const Look & Data, void (*DrawHealthBar)(DrawBatch & Batch, const Look & Data));
 	int GetState(){return State;}
 	bool DotIn(double x, double y);
-	bool IsAlive(){return Health > 0.0 && !Dead;}
-	int & GetDeadClock(){return Dead;}
+	bool IsAlive(){return Health > 0.0;}
 	virtual ~Enemy() = default;
 };
 
-template<int DotsCount, int ControlDots, typename... DoActionTypes>
-void Enemy<DotsCount, ControlDots, DoActionTypes...>::MoveEnemy(double Speed)
+template<class Model, typename... DoActionTypes>
+unsigned int Enemy<Model, DoActionTypes...>::Spawned = 0;
+
+template<class Model, typename... DoActionTypes>
+void Enemy<Model, DoActionTypes...>::MoveEnemy(double Speed)
 {
 	Center.MovePoint(Angle, Speed);
-	for(int i = 0; i < DotsCount; i++)
-		Dots[i].MovePoint(Angle, Speed);
 }
 
-template<int DotsCount, int ControlDots, typename... DoActionTypes>
-Enemy<DotsCount, ControlDots, DoActionTypes...>::Enemy()
+template<class Model, typename... DoActionTypes>
+Enemy<Model, DoActionTypes...>::Enemy()
 {
 	switch(random(Left, Down))
 	{
@@ -391,82 +934,69 @@ Enemy<DotsCount, ControlDots, DoActionTypes...>::Enemy()
 	}
 	CoolDown = 30;
 	Health = 100.0;
-	Dead = 0;
 	State = 0;
 	Damage = 10.0;
+	Id = ++Spawned;
 }
 
-template<int DotsCount, int ControlDots, typename... DoActionTypes>
-Enemy<DotsCount, ControlDots, DoActionTypes...>::Enemy(Enemy & Data)
+template<class Model, typename... DoActionTypes>
+Enemy<Model, DoActionTypes...>::Enemy(Enemy & Data)
 {
 	Center.SetDots(Data.Center.x, Data.Center.y);
 	Angle = Data.Angle;
-	for(int i = 0; i < DotsCount; i++)
-		Dots[i].SetDots(Data.Dots[i].x, Data.Dots[i].y);
-	for(int i = 0; i < ControlDots; i++)
-		Shape[i] = Data.Shape[i];
 	CoolDown = Data.CoolDown;
 	Health = Data.Health;
 	State = Data.State;
-	Dead = Data.Dead;
 	Damage = Data.Damage;
+	Id = Data.Id;
 }
 
-template<int DotsCount, int ControlDots, typename... DoActionTypes>
-void Enemy<DotsCount, ControlDots, DoActionTypes...>::DrawEnemy()
+template<class Model, typename... DoActionTypes>
+void Enemy<Model, DoActionTypes...>::DrawEnemy(DrawBatch & Batch, const Look & Data, void (*DrawHealthBar)(DrawBatch & Batch, const Look & Data))
 {
 	double Tempx, Tempy;
-	if(!Dead)
+	if(SpriteHeadings)
+		Batch.Sprite(Hull(), Data.x, Data.y, Data.Angle);
+	else
 	{
-		int DotsBuf[DotsCount*2];
-		for(int i = 0; i < DotsCount; i++)
+		int DotsBuf[Model::DotsCount*2];
+		for(int i = 0; i < Model::DotsCount; i++)
 		{
-			Tempx = Dots[i].x - Center.x;
-			Tempy = Dots[i].y - Center.y;
-			DotsBuf[i*2] = Tempx*fcos(Angle) - Tempy*fsin(-Angle) + Center.x;
-			DotsBuf[i*2 + 1] = Tempx*fsin(-Angle) + Tempy*fcos(Angle) + Center.y;
-		}
-		setfillstyle(SOLID_FILL, COLOR(128, 0, 0));
-		setcolor(COLOR(255, 0, 0));
-		fillpoly(DotsCount, DotsBuf);
-
-		if(Health < 100.0)
-		{
-			setfillstyle(SOLID_FILL, COLOR(255 * min((100.0 - Health)/50.0, 1.0), 255 * min(Health/50.0, 1.0), 0));
-			DrawHealthBar();
+			Tempx = Model::Dots[i].x;
+			Tempy = Model::Dots[i].y;
+			DotsBuf[i*2] = Tempx*fcos(Data.Angle) - Tempy*fsin(-Data.Angle) + Data.x;
+			DotsBuf[i*2 + 1] = Tempx*fsin(-Data.Angle) + Tempy*fcos(Data.Angle) + Data.y;
 		}
+		Batch.FillPoly(Model::DotsCount, DotsBuf, COLOR(255, 0, 0), COLOR(128, 0, 0));
 	}
-	else
-	{
-		setcolor(COLOR(255, 64, 0));
-		setfillstyle(SOLID_FILL, COLOR(255, 128, 0));
-		fillellipse(Center.x, Center.y, Dead*3, Dead*3);
-	}
+
+	if(Data.Health < 100.0)
+		DrawHealthBar(Batch, Data);
 }
 
-template<int DotsCount, int ControlDots, typename... DoActionTypes>
-bool Enemy<DotsCount, ControlDots, DoActionTypes...>::DotIn(double x, double y)
+template<class Model, typename... DoActionTypes>
+bool Enemy<Model, DoActionTypes...>::DotIn(double x, double y)
 {
 	double Tempx, Tempy;
-	Point DotsBuf[ControlDots];
-	for(int i = 0; i < ControlDots; i++)
+	Point DotsBuf[Model::ControlDots];
+	for(int i = 0; i < Model::ControlDots; i++)
 	{
-		Tempx = Dots[Shape[i]].x - Center.x;
-		Tempy = Dots[Shape[i]].y - Center.y;
+		Tempx = Model::Dots[Model::Shape[i]].x;
+		Tempy = Model::Dots[Model::Shape[i]].y;
 		DotsBuf[i].x = Tempx*fcos(Angle) - Tempy*fsin(-Angle) + Center.x;
 		DotsBuf[i].y = Tempx*fsin(-Angle) + Tempy*fcos(Angle) + Center.y;
 	}
 
 	int Check = 0;
 
-	for(int i = 0; i < ControlDots - 1; i++)
+	for(int i = 0; i < Model::ControlDots - 1; i++)
 		if((DotsBuf[i+1].x - DotsBuf[i].x)*(y - DotsBuf[i].y) - (DotsBuf[i+1].y - DotsBuf[i].y)*(x - DotsBuf[i].x) >= 0)
 			Check++;
 
-	if((DotsBuf[0].x - DotsBuf[ControlDots - 1].x)*(y - DotsBuf[ControlDots - 1].y) - (DotsBuf[0].y - DotsBuf[ControlDots - 1].y)*(x - DotsBuf[ControlDots - 1].x) >= 0)
+	if((DotsBuf[0].x - DotsBuf[Model::ControlDots - 1].x)*(y - DotsBuf[Model::ControlDots - 1].y) - (DotsBuf[0].y - DotsBuf[Model::ControlDots - 1].y)*(x - DotsBuf[Model::ControlDots - 1].x) >= 0)
 		Check++;
 
-	if(Check == ControlDots)
+	if(Check == Model::ControlDots)
 		return true;
 	else
 		return false;
@@ -487,9 +1017,10 @@ public:
 	void SpawnEnemy();
 	template<typename... DoActionTypes>
 	void ProcessEnemys(DoActionTypes... DoActionData);
-	void DrawEnemys(){Enemys.ForEach([](EnemyType & Data){Data.DrawEnemy();});}
+	int GetLooks(typename EnemyType::Look * Looks);
+	static void DrawEnemys(DrawBatch & Batch, const typename EnemyType::Look * Looks, int Count){for(int i = 0; i < Count; i++) EnemyType::DrawEnemy(Batch, Looks[i], EnemyType::DrawHealthBar);}
 	int GetEnemysCount(){return EnemysAlive;}
-	int CheckForDead();
+	int CheckForDead(Particles & Effects);
 	void CheckForHits(BulletsArray & BulletsForCheck);
 	void DeleteAll(){Enemys.Clear();EnemysAlive = 0;}
 };
@@ -504,17 +1035,30 @@ void EnemyList<EnemyType>::SpawnEnemy()
 	}
 }
 
+// There are never more than MaxEnemys of them.
+template<class EnemyType>
+int EnemyList<EnemyType>::GetLooks(typename EnemyType::Look * Looks)
+{
+	int Count = 0;
+	for(auto i = Enemys.GetFirstPtr(); i; i = i->NextNode)
+		Looks[Count++] = i->Data.GetLook();
+	return Count;
+}
+
+// A dead enemy leaves the list at once, and its wreck burns out in Effects.
 template<class EnemyType>
-int EnemyList<EnemyType>::CheckForDead()
+int EnemyList<EnemyType>::CheckForDead(Particles & Effects)
 {
 	int EnemysAliveNow = EnemysAlive;
-	void (*Action)(EnemyType &) = [](EnemyType & Data)
-													{
-														if(!Data.IsAlive())
-															Data.GetDeadClock()++;
-													};
-	Enemys.ForEach(Action);
-	EnemysAlive -= Enemys.DeleteAndCount([](EnemyType & Data){return Data.GetDeadClock() == EnemyType::DeadRightNow;});
+	bool (*Check)(Particles &, EnemyType &) = [](Particles & Effects, EnemyType & Data)
+																{
+																	if(Data.IsAlive())
+																		return false;
+																	typename EnemyType::Look Look = Data.GetLook();
+																	Effects.Blast(Look.x, Look.y, Particles::Under, Particles::WreckLife, COLOR(255, 64, 0), COLOR(255, 128, 0));
+																	return true;
+																};
+	EnemysAlive -= Enemys.template DeleteAndCount<Particles>(Effects, Check);
 	return EnemysAliveNow - EnemysAlive;
 }
 
@@ -523,50 +1067,52 @@ void EnemyList<EnemyType>::CheckForHits(BulletsArray & BulletsForCheck)
 {
 	void (*Action)(EnemyType &, BulletsArray::Bullet &) = [](EnemyType & Data1, BulletsArray::Bullet & Data2)
 																											{
-																												if(Data1.DotIn(Data2.BulletDot.x, Data2.BulletDot.y) && !Data2.Deletion)
+																												float x, y;
+																												Data2.GetHead(x, y);
+																												if(!Data2.Hit && Data1.DotIn(x, y))
 																												{
 																													Data1.TakeDamage();
-																													Data2.Deletion = 1;
+																													Data2.Stop();
 																												}
 																											};
 	Enemys.CompareWith(BulletsForCheck.GetBulletsList(), Action);
 }
 
 
-class Bull: public Enemy<4, 4, double, double, bool, Ship & >
+struct BullModel
+{
+	enum{DotsCount = 4, ControlDots = 4};
+	static constexpr Point Dots[DotsCount] = {{25.0, 0.0}, {-15.0, 16.0}, {-25.0, 0.0}, {-15.0, -16.0}};
+	static constexpr unsigned int Shape[ControlDots] = {0, 1, 2, 3};
+};
+
+class Bull: public Enemy<BullModel, double, double, bool, Ship & >
 {
 private:
 
 	double BurstLength;
 	double PassedWay;
 
-	virtual void DrawHealthBar();
 	void CheckForDamage(Ship & Player);
 
 public:
 
 	enum{MoveToField, Stay, Burst};
 
+	static void DrawHealthBar(DrawBatch & Batch, const Look & Data);
+
 	Bull();
-	Bull(Bull & Data): Enemy<4, 4, double, double, bool, Ship & >(Data), BurstLength(Data.BurstLength), PassedWay(Data.PassedWay){}
+	Bull(Bull & Data): Enemy<BullModel, double, double, bool, Ship & >(Data), BurstLength(Data.BurstLength), PassedWay(Data.PassedWay){}
 	virtual void DoAction(double x, double y, bool PlayerAlive, Ship & Player);
 	virtual ~Bull() = default;
 };
 
-void inline Bull::DrawHealthBar()
+void inline Bull::DrawHealthBar(DrawBatch & Batch, const Look & Data)
 {
-	bar(Center.x - 25, Center.y - 25 - 10 * std::abs(fsin(Angle)), Center.x - 25 + 50*(Health/100.0), Center.y - 30 - 10 * std::abs(fsin(Angle)));
+	Batch.Bar(Data.x - 25, Data.y - 25 - 10 * std::abs(fsin(Data.Angle)), Data.x - 25 + 50*(Data.Health/100.0), Data.y - 30 - 10 * std::abs(fsin(Data.Angle)), HealthColor(Data.Health));
 }
 
-Bull::Bull(): Enemy<4, 4, double, double, bool, Ship & >(), BurstLength(0.0), PassedWay(0.0)
-{
-	Dots[0].SetDots(Center.x + 25.0, Center.y);
-	Dots[1].SetDots(Center.x - 15.0, Center.y + 16.0);
-	Dots[2].SetDots(Center.x - 25.0, Center.y);
-	Dots[3].SetDots(Center.x - 15.0, Center.y - 16.0);
-	for(int i = 0; i < 4; i++)
-		Shape[i] = i;
-}
+Bull::Bull(): Enemy<BullModel, double, double, bool, Ship & >(), BurstLength(0.0), PassedWay(0.0){}
 
 template<>
 template<>
@@ -621,45 +1167,35 @@ void Bull::DoAction(double x, double y, bool PlayerAlive, Ship & Player)
 	}
 }
 
-class Turret: public Enemy<10, 6, double, double, bool, BulletsArray &>
+struct TurretModel
 {
-private:
-
-	virtual void DrawHealthBar();
+	enum{DotsCount = 10, ControlDots = 6};
+	static constexpr Point Dots[DotsCount] = {{15.0, 0.0}, {-7.5, -10.5}, {0.0, -18.0}, {22.5, -12.0}, {-4.5, -30.0},
+											  {-30.0, 0.0}, {-4.5, 30.0}, {22.5, 12.0}, {0.0, 18.0}, {-7.5, 10.5}};
+	static constexpr unsigned int Shape[ControlDots] = {7, 6, 5, 4, 3, 0};
+};
 
+class Turret: public Enemy<TurretModel, double, double, bool, BulletsArray &>
+{
 public:
 
 	enum{MoveToField, Shooting};
 
+	static void DrawHealthBar(DrawBatch & Batch, const Look & Data);
+
 	Turret();
-	Turret(Turret & Data): Enemy<10, 6, double, double, bool, BulletsArray &>(Data){}
+	Turret(Turret & Data): Enemy<TurretModel, double, double, bool, BulletsArray &>(Data){}
 	virtual void DoAction(double x, double y, bool PlayerAlive, BulletsArray & EnemeyBullets);
 	virtual ~Turret() = default;
 };
 
-void inline Turret::DrawHealthBar()
-{
-	bar(Center.x - 25, Center.y - 37, Center.x - 25 + 50*(Health/100.0), Center.y - 42);
-}
-
-Turret::Turret(): Enemy<10, 6, double, double, bool, BulletsArray &>()
-{
-	Dots[0].SetDots(Center.x + 15.0, Center.y);
-	Dots[1].SetDots(Center.x - 7.5, Center.y - 10.5);
-	Dots[2].SetDots(Center.x, Center.y - 18.0);
-	Dots[3].SetDots(Center.x + 22.5, Center.y - 12.0);
-	Dots[4].SetDots(Center.x - 4.5, Center.y - 30.0);
-	Dots[5].SetDots(Center.x - 30.0, Center.y);
-	Dots[6].SetDots(Center.x - 4.5, Center.y + 30.0);
-	Dots[7].SetDots(Center.x + 22.5, Center.y + 12.0);
-	Dots[8].SetDots(Center.x, Center.y + 18.0);
-	Dots[9].SetDots(Center.x - 7.5, Center.y + 10.5);
-	Shape[0] = 7;
-	Shape[1] = 6;
-	Shape[2] = 5;
-	Shape[3] = 4;
-	Shape[4] = 3;
-	Shape[5] = 0;
+void inline Turret::DrawHealthBar(DrawBatch & Batch, const Look & Data)
+{
+	Batch.Bar(Data.x - 25, Data.y - 37, Data.x - 25 + 50*(Data.Health/100.0), Data.y - 42, HealthColor(Data.Health));
+}
+
+Turret::Turret(): Enemy<TurretModel, double, double, bool, BulletsArray &>()
+{
 	Damage = 5.0;
 }
 
@@ -691,8 +1227,8 @@ void Turret::DoAction(double x, double y, bool PlayerAlive, BulletsArray & Eneme
 			if(CoolDown == 0 && PlayerAlive)
 			{
 				Point DotsBuf;
-				double Tempx = Dots[0].x - Center.x;
-				double Tempy = Dots[0].y - Center.y;
+				double Tempx = TurretModel::Dots[0].x;
+				double Tempy = TurretModel::Dots[0].y;
 				DotsBuf.x = Tempx*fcos(Angle) - Tempy*fsin(-Angle) + Center.x;
 				DotsBuf.y = Tempx*fsin(-Angle) + Tempy*fcos(Angle) + Center.y;
 				EnemeyBullets.CreateBullet(DotsBuf.x, DotsBuf.y, Angle + random(-0.05, 0.05));
@@ -705,45 +1241,41 @@ void Turret::DoAction(double x, double y, bool PlayerAlive, BulletsArray & Eneme
 	}
 }
 
-class LaserWall: public Enemy<7, 5, double, double, bool, BulletsArray &>
+struct LaserWallModel
+{
+	enum{DotsCount = 7, ControlDots = 5};
+	static constexpr Point Dots[DotsCount] = {{0.0, -10.0}, {30.0, -10.0}, {0.0, -30.0}, {-30.0, 0.0},
+											  {0.0, 30.0}, {30.0, 10.0}, {0.0, 10.0}};
+	static constexpr unsigned int Shape[ControlDots] = {5, 4, 3, 2, 1};
+};
+
+class LaserWall: public Enemy<LaserWallModel, double, double, bool, BulletsArray &>
 {
 private:
 
 	Point NewPosition;
 	counter<1> ShootCnt;
 
-	virtual void DrawHealthBar();
-
 public:
 
 	enum{MoveToField, Stay, Prepare, Shooting, Redislocation};
 
+	static void DrawHealthBar(DrawBatch & Batch, const Look & Data);
+
 	LaserWall();
-	LaserWall(LaserWall & Data): Enemy<7, 5, double, double, bool, BulletsArray &>(Data){}
+	LaserWall(LaserWall & Data): Enemy<LaserWallModel, double, double, bool, BulletsArray &>(Data){}
 	virtual void DoAction(double x, double y, bool PlayerAlive, BulletsArray & LaserBullets);
 	virtual ~LaserWall() = default;
 
 };
 
-void LaserWall::DrawHealthBar()
+void LaserWall::DrawHealthBar(DrawBatch & Batch, const Look & Data)
 {
-	bar(Center.x - 25, Center.y - 37, Center.x - 25 + 50*(Health/100.0), Center.y - 42);
+	Batch.Bar(Data.x - 25, Data.y - 37, Data.x - 25 + 50*(Data.Health/100.0), Data.y - 42, HealthColor(Data.Health));
 }
 
 LaserWall::LaserWall()
 {
-	Dots[0].SetDots(Center.x, Center.y - 10.0);
-	Dots[1].SetDots(Center.x + 30.0, Center.y - 10.0);
-	Dots[2].SetDots(Center.x, Center.y - 30.0);
-	Dots[3].SetDots(Center.x - 30.0, Center.y);
-	Dots[4].SetDots(Center.x, Center.y + 30.0);
-	Dots[5].SetDots(Center.x + 30.0, Center.y + 10.0);
-	Dots[6].SetDots(Center.x, Center.y + 10.0);
-	Shape[0] = 5;
-	Shape[1] = 4;
-	Shape[2] = 3;
-	Shape[3] = 2;
-	Shape[4] = 1;
 	Damage = 3.5;
 }
 
@@ -821,18 +1353,23 @@ void LaserWall::DoAction(double x, double y, bool PlayerAlive, BulletsArray & La
 	}
 }
 
+struct ShipModel
+{
+	enum{DotsCount = 4};
+	static constexpr Point Dots[DotsCount] = {{25.0, 0.0}, {-15.0, 16.0}, {-10.0, 0.0}, {-15.0, -16.0}};
+	static constexpr Point Shooters[2] = {{-2.0, -7.0}, {-2.0, 7.0}};
+};
+
 class Ship
 {
 private:
 
 	Point Center;
 	double Angle;
-	Point Dots[4];
 	counter<1> ShooterCnt;
 	counter<3> Flick;
 	int DamageCoolDown;
 	int CoolDown;
-	Point Shooters[2];
 	double Speed;
 	double MaxSpeed;
 	int Acceleration;
@@ -850,6 +1387,8 @@ public:
 	void MoveShip(int Where);
 	void GetDots(double Dots[8]);
 	void GetCenter(double xy[2]){xy[0] = Center.x, xy[1] = Center.y;}
+	double GetAngle(){return Angle;}
+	static const SpriteAtlas & Hull(){static const SpriteAtlas Atlas(ShipModel::DotsCount, ShipModel::Dots, COLOR(0, 254, 0), COLOR(0, 128, 0)); return Atlas;}
 	enum{Center_x, Center_y};
 	double GetCenter(int x_or_y){return x_or_y? Center.y: Center.x;}
 	bool GetDots(int Dots[8]);
@@ -912,13 +1451,7 @@ Ship::Ship()
 {
 	Center.SetDots(ScreenHalfWidth, ScreenHalfHeight);
 	Angle = pi/2.0;
-	Dots[0].SetDots(Center.x + 25.0, Center.y);
-	Dots[1].SetDots(Center.x - 15.0, Center.y + 16.0);
-	Dots[2].SetDots(Center.x - 10.0, Center.y);
-	Dots[3].SetDots(Center.x - 15.0, Center.y - 16.0);
 	ShooterCnt = 0;
-	Shooters[0].SetDots(Center.x - 2, Center.y - 7);
-	Shooters[1].SetDots(Center.x - 2, Center.y + 7);
 	Speed = 0.0;
 	MaxSpeed = 6.0;
 	Acceleration = false;
@@ -936,13 +1469,7 @@ void Ship::Reset()
 {
 	Center.SetDots(ScreenHalfWidth, ScreenHalfHeight);
 	Angle = pi/2.0;
-	Dots[0].SetDots(Center.x + 25.0, Center.y);
-	Dots[1].SetDots(Center.x - 15.0, Center.y + 16.0);
-	Dots[2].SetDots(Center.x - 10.0, Center.y);
-	Dots[3].SetDots(Center.x - 15.0, Center.y - 16.0);
 	ShooterCnt = 0;
-	Shooters[0].SetDots(Center.x - 2, Center.y - 7);
-	Shooters[1].SetDots(Center.x - 2, Center.y + 7);
 	Speed = 0.0;
 	MaxSpeed = 6.0;
 	Acceleration = false;
@@ -969,8 +1496,8 @@ void Ship::Shoot(BulletsArray & Bullets)
 	if(CoolDown < 5 || Energy < 3.5)
 		return;
 	double Resultx, Resulty;
-	Resultx = (Shooters[ShooterCnt].x - Center.x)*fcos(Angle) - (Shooters[ShooterCnt].y - Center.y)*fsin(-Angle) + Center.x;
-	Resulty = (Shooters[ShooterCnt].x - Center.x)*fsin(-Angle) + (Shooters[ShooterCnt].y - Center.y)*fcos(Angle) + Center.y;
+	Resultx = ShipModel::Shooters[ShooterCnt].x*fcos(Angle) - ShipModel::Shooters[ShooterCnt].y*fsin(-Angle) + Center.x;
+	Resulty = ShipModel::Shooters[ShooterCnt].x*fsin(-Angle) + ShipModel::Shooters[ShooterCnt].y*fcos(Angle) + Center.y;
 	Bullets.CreateBullet(Resultx, Resulty, Angle);
 	ShooterCnt++;
 	if(!InfinityEnergy)
@@ -984,8 +1511,8 @@ bool Ship::DotIn(double x, double y)
 	Point DotsBuf[4];
 	for(int i = 0; i < 4; i++)
 	{
-		Tempx = Dots[i].x - Center.x;
-		Tempy = Dots[i].y - Center.y;
+		Tempx = ShipModel::Dots[i].x;
+		Tempy = ShipModel::Dots[i].y;
 		DotsBuf[i].x = Tempx*fcos(Angle) - Tempy*fsin(-Angle) + Center.x;
 		DotsBuf[i].y = Tempx*fsin(-Angle) + Tempy*fcos(Angle) + Center.y;
 	}
@@ -1001,11 +1528,13 @@ void Ship::CheckForHits(BulletsArray & EnemyBullets, double HowManyDamageOccur)
 {
 	void (*Action)(Ship &, double &, BulletsArray::Bullet &) = [](Ship & Player, double & HowManyDamageOccur, BulletsArray::Bullet & Bullet)
 																																			{
-																																				if(Player.DotIn(Bullet.BulletDot.x, Bullet.BulletDot.y) && !Bullet.Deletion)
+																																				float x, y;
+																																				Bullet.GetHead(x, y);
+																																				if(!Bullet.Hit && Player.DotIn(x, y))
 																																				{
 																																					if(!Player.IsInvincible())
 																																						Player.TakeDamage(HowManyDamageOccur);
-																																					Bullet.Deletion = 1;
+																																					Bullet.Stop();
 																																				}
 																																			};
 	EnemyBullets.GetBulletsList().CompareWith<Ship, double>(*this, HowManyDamageOccur, Action);
@@ -1021,12 +1550,6 @@ void Ship::MoveShip(int Where)
 {
 	double NewAngle = Angle + pi/2.0 * Where;
 	Center.MovePoint(NewAngle, Speed);
-	Dots[0].MovePoint(NewAngle, Speed);
-	Dots[1].MovePoint(NewAngle, Speed);
-	Dots[2].MovePoint(NewAngle, Speed);
-	Dots[3].MovePoint(NewAngle, Speed);
-	Shooters[0].MovePoint(NewAngle, Speed);
-	Shooters[1].MovePoint(NewAngle, Speed);
 }
 
 void Ship::GetDots(double DotsBuf[8])
@@ -1034,8 +1557,8 @@ void Ship::GetDots(double DotsBuf[8])
 	double Tempx, Tempy;
 	for(int i = 0; i < 4; i++)
 	{
-		Tempx = Dots[i].x - Center.x;
-		Tempy = Dots[i].y - Center.y;
+		Tempx = ShipModel::Dots[i].x;
+		Tempy = ShipModel::Dots[i].y;
 		DotsBuf[i*2] = Tempx*fcos(Angle) - Tempy*fsin(-Angle) + Center.x;
 		DotsBuf[i*2 + 1] = Tempx*fsin(-Angle) + Tempy*fcos(Angle) + Center.y;
 	}
@@ -1049,8 +1572,8 @@ bool Ship::GetDots(int DotsBuf[8])
 	double Tempx, Tempy;
 	for(int i = 0; i < 4; i++)
 	{
-		Tempx = Dots[i].x - Center.x;
-		Tempy = Dots[i].y - Center.y;
+		Tempx = ShipModel::Dots[i].x;
+		Tempy = ShipModel::Dots[i].y;
 		DotsBuf[i*2] = Tempx*fcos(Angle) - Tempy*fsin(-Angle) + Center.x;
 		DotsBuf[i*2 + 1] = Tempx*fsin(-Angle) + Tempy*fcos(Angle) + Center.y;
 	}
@@ -1067,34 +1590,527 @@ struct MovableStar
 	bool inScreen(int w, int h){return (x > 0 && y > 0 && x < w && y < h);}
 };
 
-struct StaticStar
+class StarField
 {
-	double x = random((ScreenWidth - Diagonal)/2.0 - 25, Diagonal + 25);
-	double y = random((ScreenWidth - Diagonal)/2.0 - 25, Diagonal + 25);
+private:
+
+	int Count;
+	float * Basex;
+	float * Basey;
+	int * Colors;
+	int * XY;
+	double Angle;
+
+public:
 
-	int Color = COLOR(random(160, 255), random(160, 255), random(160, 255));
+	StarField(int Count_);
+	StarField(StarField &) = delete;
+	StarField & operator=(StarField &) = delete;
+	void Reset();
+	double Turn(){return Angle += 0.0005;}
+	void Draw(double Angle, double Shiftx, double Shifty, int Share = 100) const;
+	#ifdef StarStats
+	void Compare(int Shown) const;
+	#endif
+	~StarField();
 };
 
+StarField::StarField(int Count_): Count(Count_), Angle(0.0)
+{
+	Basex = new float[Count];
+	Basey = new float[Count];
+	Colors = new int[Count];
+	XY = new int[Count*2];
+	Reset();
+}
+
+StarField::~StarField()
+{
+	delete [] Basex;
+	delete [] Basey;
+	delete [] Colors;
+	delete [] XY;
+}
+
+// The base offsets are kept as x and y rather than as a radius and an angle:
+// the frame turns them with one sine and cosine either way, and drawing x and
+// y at random fills the square around the screen evenly, as the stars always
+// did, where a random radius would crowd them at the center.
+void StarField::Reset()
+{
+	Angle = 0.0;
+	for(int i = 0; i < Count; i++)
+	{
+		Basex[i] = random((ScreenWidth - Diagonal)/2.0 - 25, Diagonal + 25) - ScreenHalfWidth;
+		Basey[i] = random((ScreenWidth - Diagonal)/2.0 - 25, Diagonal + 25) - ScreenHalfHeight;
+		Colors[i] = COLOR(random(160, 255), random(160, 255), random(160, 255));
+	}
+}
+
+// Stars are never moved: every frame the whole sky is their base offsets from
+// the screen center turned by one global angle, which Turn moves on once per
+// tick. Iterations don't depend on each other, so the loop is left for the
+// compiler to vectorize. The stars are spread at random, so drawing only the
+// first Share percent of them thins the whole sky evenly. With StarStats
+// defined, every frame draws them a second time for Compare.
+void StarField::Draw(double Angle, double Shiftx, double Shifty, int Share) const
+{
+	const float c = fcos(Angle), s = fsin(Angle);
+	const float Originx = ScreenHalfWidth - Shiftx, Originy = ScreenHalfHeight - Shifty;
+	const int Shown = Count*Share/100;
+	for(int i = 0; i < Shown; i++)
+	{
+		XY[i*2] = Basex[i]*c - Basey[i]*s + Originx;
+		XY[i*2 + 1] = Basex[i]*s + Basey[i]*c + Originy;
+	}
+	#ifdef StarStats
+	Compare(Shown);
+	#endif
+	putpixels(Shown, XY, Colors);
+}
+
+// Times drawing the stars of the frame with one putpixel per star against one
+// putpixels call, and prints the means once a second. Both backends may hold
+// drawing back until the frame ends, so each is followed by a getpixel, which
+// draws what is held first.
+#ifdef StarStats
+void StarField::Compare(int Shown) const
+{
+	typedef std::chrono::steady_clock Clock;
+	static double Single = 0.0, Bulk = 0.0;
+	static int Frames = 0;
+	static Clock::time_point Reported = Clock::now();
+
+	getpixel(0, 0);
+	const Clock::time_point Start = Clock::now();
+	for(int i = 0; i < Shown; i++)
+		putpixel(XY[i*2], XY[i*2 + 1], Colors[i]);
+	getpixel(0, 0);
+	const Clock::time_point Middle = Clock::now();
+	putpixels(Shown, XY, Colors);
+	getpixel(0, 0);
+	const Clock::time_point End = Clock::now();
+
+	Single += std::chrono::duration<double>(Middle - Start).count();
+	Bulk += std::chrono::duration<double>(End - Middle).count();
+	Frames++;
+	if(End - Reported < std::chrono::seconds(1))
+		return;
+	std::cout << "stars: " << Shown << " a frame, putpixel " << static_cast<int>(Single/Frames*1e6) << " us, putpixels "
+			  << static_cast<int>(Bulk/Frames*1e6) << " us" << std::endl;
+	Single = Bulk = 0.0;
+	Frames = 0;
+	Reported = End;
+}
+#endif
+
+// The values the HUD shows. The energy graph, the phase of the heartbeat and
+// the bulbs of the cheats are kept up to date by TrackGui, once per tick.
+struct GuiLook
+{
+	double Health;
+	double GraphPhase;
+	double Time;
+	int Energy;
+	double EnergyGraph[30];
+	unsigned int Kills;
+	double k;
+	bool LoseBulb;
+	bool GodModeUsed;
+	bool InfEnergyUsed;
+};
+
+// Everything a frame shows, copied out of the game at the start of a tick.
+// Once published it is never changed, so it can be drawn on another thread
+// while the next ticks are simulated.
+struct RenderSnapshot
+{
+	double Shiftx, Shifty;
+	int BullsCount, TurretsCount, LasersCount;
+	Bull::Look Bulls[MaxBulls];
+	Turret::Look Turrets[MaxTurrets];
+	LaserWall::Look Lasers[MaxLasers];
+	bool PlayerShown;
+	int PlayerDots[8];
+	double PlayerCenter[2];
+	double PlayerAngle;
+	double SkyAngle;
+	std::vector<BulletsArray::BulletLook> PlayerBullets, EnemyBullets, LaserBullets;
+	GuiLook Gui;
+	Particles Effects;
+	std::chrono::steady_clock::time_point Time;	// When it was published
+};
+
+static inline double Mix(double From, double To, double Alpha){return From + (To - From)*Alpha;}
+static inline double MixAngle(double From, double To, double Alpha){return From + remainder(To - From, 2.0*pi)*Alpha;}
+
+template<class Look>
+static void InterpolateLooks(Look * Looks, int Count, const Look * From, int FromCount, double Alpha)
+{
+	for(int i = 0, j = 0; i < Count; i++)
+	{
+		while(j < FromCount && From[j].Id < Looks[i].Id)
+			j++;
+		if(j < FromCount && From[j].Id == Looks[i].Id)
+		{
+			Looks[i].x = Mix(From[j].x, Looks[i].x, Alpha);
+			Looks[i].y = Mix(From[j].y, Looks[i].y, Alpha);
+			Looks[i].Angle = MixAngle(From[j].Angle, Looks[i].Angle, Alpha);
+		}
+	}
+}
+
+// Moves what Frame shows back toward the snapshot before it, so that Alpha 0
+// shows From and 1 leaves Frame as it is. Enemies that just spawned are shown
+// where they are, and bullets that just flew out are moved back along their
+// way as well. A ship that jumped (a new game) isn't moved, nor is the sky.
+static void Interpolate(RenderSnapshot & Frame, const RenderSnapshot & From, double Alpha)
+{
+	InterpolateLooks(Frame.Bulls, Frame.BullsCount, From.Bulls, From.BullsCount, Alpha);
+	InterpolateLooks(Frame.Turrets, Frame.TurretsCount, From.Turrets, From.TurretsCount, Alpha);
+	InterpolateLooks(Frame.Lasers, Frame.LasersCount, From.Lasers, From.LasersCount, Alpha);
+
+	for(std::vector<BulletsArray::BulletLook> * Looks : {&Frame.PlayerBullets, &Frame.EnemyBullets, &Frame.LaserBullets})
+		for(BulletsArray::BulletLook & Data : *Looks)
+		{
+			Data.Tailx -= Data.dx*(1.0 - Alpha), Data.Taily -= Data.dy*(1.0 - Alpha);
+			Data.Headx -= Data.dx*(1.0 - Alpha), Data.Heady -= Data.dy*(1.0 - Alpha);
+		}
+
+	if(fabs(Frame.PlayerCenter[0] - From.PlayerCenter[0]) + fabs(Frame.PlayerCenter[1] - From.PlayerCenter[1]) > 50.0)
+		return;
+	Frame.Shiftx = Mix(From.Shiftx, Frame.Shiftx, Alpha);
+	Frame.Shifty = Mix(From.Shifty, Frame.Shifty, Alpha);
+	Frame.SkyAngle = MixAngle(From.SkyAngle, Frame.SkyAngle, Alpha);
+	Frame.Gui.GraphPhase = Mix(From.Gui.GraphPhase, Frame.Gui.GraphPhase, Alpha);
+	if(Frame.PlayerShown && From.PlayerShown)
+		for(int i = 0; i < 8; i++)
+			Frame.PlayerDots[i] = lround(Mix(From.PlayerDots[i], Frame.PlayerDots[i], Alpha));
+	for(int i = 0; i < 2; i++)
+		Frame.PlayerCenter[i] = Mix(From.PlayerCenter[i], Frame.PlayerCenter[i], Alpha);
+	Frame.PlayerAngle = MixAngle(From.PlayerAngle, Frame.PlayerAngle, Alpha);
+}
+
+// Scales the optional drawing down when frames take too long, and back up
+// once they leave room again. It keeps the times of the last Window frames,
+// drawing and presenting, and compares their mean to the time a frame has.
+// Above HighLoad of it, it drops a level at once; it only raises one after
+// RaiseAfter frames in a row below LowLoad, which is low enough for the level
+// above not to be dropped again right away. After every change the window is
+// filled anew before it decides again. With QualityStats defined, the level
+// and the mean frame time are printed at every change and once a second.
+//
+// Frame times depend on the machine, so with SerialRendering defined it only
+// measures and stays at the full level, and replays keep giving the same
+// frames.
+class QualityGovernor
+{
+public:
+
+	// What a level draws
+	struct Level
+	{
+		int StarsShare;		// Percent of the stars drawn
+		int GraphStep;		// Pixels between the points of the heartbeat graph
+		int ImpactDetail;	// 2 for bullet impacts with their tails, 1 without, 0 for none
+		int GuiInterval;	// Frames the readouts of the HUD are drawn once in
+	};
+
+private:
+
+	enum{Window = 32, RaiseAfter = 240, LevelsCount = 4};
+	static constexpr double HighLoad = 0.75, LowLoad = 0.4;
+	static const Level Levels[LevelsCount];
+
+	int Current;
+	double Times[Window];
+	double Sum;
+	int Count, Next;
+	int Calm;
+	std::chrono::steady_clock::time_point Start, Reported;
+
+	static double Budget(){return RenderRate? 1.0/RenderRate: DelayTime/1000.0;}
+	void Change(int Step);
+	void Report();
+
+public:
+
+	QualityGovernor(): Current(0), Sum(0.0), Count(0), Next(0), Calm(0){}
+	const Level & Get() const {return Levels[Current];}
+	void Begin(){Start = std::chrono::steady_clock::now();}
+	void End();
+};
+
+const QualityGovernor::Level QualityGovernor::Levels[QualityGovernor::LevelsCount] = {{100, 1, 2, 1},
+																					   {60, 2, 2, 1},
+																					   {35, 2, 1, 2},
+																					   {20, 4, 0, 4}};
+
+void QualityGovernor::End()
+{
+	double Time = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	if(Count == Window)
+		Sum -= Times[Next];
+	else
+		Count++;
+	Sum += Times[Next] = Time;
+	Next = (Next + 1) % Window;
+	if(Count < Window)
+		return;
+
+	#ifndef SerialRendering
+	double Mean = Sum/Window;
+	if(Mean > HighLoad*Budget() && Current < LevelsCount - 1)
+		Change(1);
+	else if(Mean < LowLoad*Budget() && Current > 0)
+	{
+		if(++Calm >= RaiseAfter)
+			Change(-1);
+	}
+	else
+		Calm = 0;
+	#endif
+	#ifdef QualityStats
+	if(Start - Reported > std::chrono::seconds(1))
+		Report();
+	#endif
+}
+
+void QualityGovernor::Change(int Step)
+{
+	#ifdef QualityStats
+	Report();
+	#endif
+	Current += Step;
+	Sum = 0.0;
+	Count = Next = Calm = 0;
+	#ifdef QualityStats
+	Report();
+	#endif
+}
+
+void QualityGovernor::Report()
+{
+	#ifdef QualityStats
+	const Level & Data = Levels[Current];
+	std::cout << "quality: level " << Current << " (stars " << Data.StarsShare << "%, graph step " << Data.GraphStep
+			  << ", impact detail " << Data.ImpactDetail << ", HUD every " << Data.GuiInterval << " frames), frame "
+			  << (Count? static_cast<int>(Sum/Count*1e6): 0) << " of " << static_cast<int>(Budget()*1e6) << " us" << std::endl;
+	Reported = Start;
+	#endif
+}
+
+// Frames drawn by the render thread, the serial rendering and the main menu
+// are timed for it.
+static QualityGovernor Quality;
+
+// Draws the published snapshots on its own thread. There are three of them:
+// the game fills the back one, the thread draws the front one, and the one in
+// between is the latest published and not drawn yet. Neither side ever waits
+// for the other to finish: publishing again before the thread gets to it
+// just replaces it, so the thread always draws the latest one there is.
+//
+// Only one thread may draw at a time. Before the game draws by itself (the
+// menus on top of a frame), it waits until the thread is done with its frame,
+// and drops one that was not started yet.
+//
+// With RenderRate set, the thread also draws in between new snapshots, at that
+// rate. It then keeps the snapshot it drew before the front one as well, and
+// shows the part of the way from it to the front one that the time since the
+// front one was published is of the time between the two, one tick late at
+// most. It draws nothing more once the game drew by itself, until the next
+// snapshot.
+//
+// With SerialRendering defined there is no thread, and every snapshot is drawn
+// as it is published. Presented frames then follow the ticks one to one again,
+// which headless replays need to give the same frames every time.
+class RenderThread
+{
+private:
+
+	RenderSnapshot Snapshots[4];
+	RenderSnapshot Shown;
+	int Back, Ready, Front, Previous;
+	bool Fresh;
+	bool Redraw;
+	bool Drawing;
+	bool Quit;
+	std::chrono::steady_clock::time_point NextDraw;
+	std::function<void(const RenderSnapshot &)> Draw;
+	std::mutex Lock;
+	std::condition_variable Wake;
+	std::condition_variable Idle;
+	std::thread Thread;
+
+	bool NextFrame();
+	const RenderSnapshot & Interpolated();
+
+public:
+
+	RenderThread(std::function<void(const RenderSnapshot &)> Draw_);
+	RenderThread(RenderThread &) = delete;
+	RenderThread & operator=(RenderThread &) = delete;
+	RenderSnapshot & GetBack(){return Snapshots[Back];}
+	void Publish();
+	void Wait();
+	~RenderThread();
+};
+
+RenderThread::RenderThread(std::function<void(const RenderSnapshot &)> Draw_): Back(0), Ready(1), Front(2), Previous(3), Fresh(false), Redraw(false), Drawing(false), Quit(false), Draw(Draw_)
+{
+	#ifndef SerialRendering
+	Thread = std::thread([this]
+						 {
+							 while(NextFrame())
+							 {
+								 Quality.Begin();
+								 Draw(RenderRate? Interpolated(): Snapshots[Front]);
+								 swapbuffers();
+								 Quality.End();
+							 }
+						 });
+	#endif
+}
+
+RenderThread::~RenderThread()
+{
+	if(!Thread.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> Guard(Lock);
+		Quit = true;
+	}
+	Wake.notify_one();
+	Thread.join();
+}
+
+bool RenderThread::NextFrame()
+{
+	std::unique_lock<std::mutex> Guard(Lock);
+	Drawing = false;
+	Idle.notify_all();
+	if(RenderRate)
+		Wake.wait_until(Guard, NextDraw, [this]{return Quit;});
+	Wake.wait(Guard, [this]{return Fresh || Redraw || Quit;});
+	if(Quit)
+		return false;
+	if(Fresh)
+	{
+		int Oldest = Previous;
+		Previous = Front, Front = Ready, Ready = Oldest;
+		Fresh = false;
+		Redraw = true;
+	}
+	NextDraw += std::chrono::microseconds(1000000/max(RenderRate, 1));
+	if(NextDraw < std::chrono::steady_clock::now())
+		NextDraw = std::chrono::steady_clock::now();
+	Drawing = true;
+	return true;
+}
+
+// A gap of more than a few ticks between the two snapshots is a pause, or a
+// new game, so the front one is shown as it is.
+const RenderSnapshot & RenderThread::Interpolated()
+{
+	const RenderSnapshot & From = Snapshots[Previous];
+	Shown = Snapshots[Front];
+	double Span = std::chrono::duration<double>(Shown.Time - From.Time).count();
+	if(Span <= 0.0 || Span > 4.0*DelayTime/1000.0)
+		return Shown;
+	double Alpha = std::chrono::duration<double>(std::chrono::steady_clock::now() - Shown.Time).count()/Span;
+	if(Alpha < 1.0)
+		Interpolate(Shown, From, Alpha);
+	return Shown;
+}
+
+void RenderThread::Publish()
+{
+	#ifdef SerialRendering
+	Quality.Begin();
+	Draw(Snapshots[Back]);
+	swapbuffers();
+	Quality.End();
+	#else
+	{
+		std::lock_guard<std::mutex> Guard(Lock);
+		Snapshots[Back].Time = std::chrono::steady_clock::now();
+		std::swap(Back, Ready);
+		Fresh = true;
+	}
+	Wake.notify_one();
+	#endif
+}
+
+void RenderThread::Wait()
+{
+	std::unique_lock<std::mutex> Guard(Lock);
+	Fresh = Redraw = false;
+	Idle.wait(Guard, [this]{return !Drawing;});
+}
+
+// The enemies and the ship go through one batch, and the bulbs of the HUD
+// through another. Only one thread draws at a time, so the batch is shared.
+static void DrawFrame(const RenderSnapshot & Frame, StarField & Stars, const BulletsArray & PlayerBullets, const BulletsArray & EnemyBullets, const BulletsArray & LaserBullets)
+{
+	static DrawBatch Batch;
+
+	beginframe();
+	cleardevice();
+	Stars.Draw(Frame.SkyAngle, Frame.Shiftx, Frame.Shifty, Quality.Get().StarsShare);
+
+	EnemyList<Bull>::DrawEnemys(Batch, Frame.Bulls, Frame.BullsCount);
+	EnemyList<Turret>::DrawEnemys(Batch, Frame.Turrets, Frame.TurretsCount);
+	EnemyList<LaserWall>::DrawEnemys(Batch, Frame.Lasers, Frame.LasersCount);
+	Frame.Effects.Draw(Batch, Particles::Under);
+
+	if(Frame.PlayerShown && SpriteHeadings)
+		Batch.Sprite(Ship::Hull(), Frame.PlayerCenter[0], Frame.PlayerCenter[1], Frame.PlayerAngle);
+	else if(Frame.PlayerShown)
+		Batch.FillPoly(4, Frame.PlayerDots, COLOR(0, 254, 0), COLOR(0, 128, 0));
+	Batch.Flush();
+	PlayerBullets.DrawBullets(Frame.PlayerBullets);
+	EnemyBullets.DrawBullets(Frame.EnemyBullets);
+	LaserBullets.DrawBullets(Frame.LaserBullets);
+	Frame.Effects.Draw(Batch, Particles::Impacts, Quality.Get().ImpactDetail);
+	Batch.Flush();
+
+	DrawGui(Batch, Frame.Gui);
+
+	Frame.Effects.Draw(Batch, Particles::Over);
+	Batch.Flush();
+	Batch.Report();
+	endframe();
+}
+
 int main()
 {
 	srand(time(0));
 	initwindow(ScreenWidth, ScreenHeight, "Space War", 100, 50, true, false);
+	setrecordingbgi(true);
 	#ifdef IncludeCosTable
 	InitCosTable();
 	#endif
+	Bull::Hull();
+	Turret::Hull();
+	LaserWall::Hull();
+	Ship::Hull();
+	Chrome();
 	const int StarsCount = 1750;
-	int GameProccessed = GameEnded, Kills, PlayerDots[8], Mousex, Mousey, PlayerMove, iddqd, idkfa, LoseDelay, PlayerBlowUp;
-	float Tempx, Tempy;
+	int GameProccessed = GameEnded, Kills, Mousex, Mousey, PlayerMove, iddqd, idkfa, LoseDelay;
 	double PlayingTime, k, EnergyGraph[30];
 	Ship Player;
-	EnemyList<Bull> Bulls(7);
-	EnemyList<Turret> Turrets(4);
-	EnemyList<LaserWall> Lasers(2);
+	StarField Stars(StarsCount);
+	EnemyList<Bull> Bulls(MaxBulls);
+	EnemyList<Turret> Turrets(MaxTurrets);
+	EnemyList<LaserWall> Lasers(MaxLasers);
 	BulletsArray PlayerBullets(192, 255, 255, 8, 2), EnemyBullets(255, 128, 128, 6, 4), LaserBullets(255, 64, 64, 18, 20);
+	Particles Effects;
 	bool Shooting, Lose;
+	auto Draw = [&](const RenderSnapshot & Frame){DrawFrame(Frame, Stars, PlayerBullets, EnemyBullets, LaserBullets);};
+	RenderThread Renderer(Draw);
 	while(menuProcess(GameProccessed))
 	{
-		StaticStar Stars[StarsCount];
+		Stars.Reset();
 		GameProccessed = GameInProcess;
 		PlayingTime = 0.0;
 		Kills = 0;
@@ -1106,6 +2122,7 @@ int main()
 		Bulls.DeleteAll();
 		Turrets.DeleteAll();
 		Lasers.DeleteAll();
+		Effects.Clear();
 		PlayerMove = Ship::Ahead;
 		Mousex = ScreenHalfWidth;
 		Mousey = 0;
@@ -1115,78 +2132,58 @@ int main()
 		iddqd = 0;
 		idkfa = 0;
 		LoseDelay = 200;
-		PlayerBlowUp = 0;
 		for(int i = 0; i < 30; i++) EnergyGraph[i] = 100.0;
 		while(GameProccessed)
 		{
-			cleardevice();
-			for(int i = 0; i < StarsCount; i++)
-			{
-				Tempx = Stars[i].x - ScreenHalfWidth;
-				Tempy = Stars[i].y - ScreenHalfHeight;
-				Stars[i].x = Tempx * cos0_0005 - Tempy * sin0_0005;
-				Stars[i].y = Tempx * sin0_0005 + Tempy * cos0_0005;
-				Stars[i].x += ScreenHalfWidth;
-				Stars[i].y += ScreenHalfHeight;
-				putpixel(Stars[i].x - 25.0*Player.GetCenter(Ship::Center_x)/ScreenWidth, Stars[i].y - 25.0*Player.GetCenter(Ship::Center_y)/ScreenHeight, Stars[i].Color);
-			}
-
-			Bulls.DrawEnemys();
-			Turrets.DrawEnemys();
-			Lasers.DrawEnemys();
-
-			if(Player.GetDots(PlayerDots))
-			{
-				setfillstyle(SOLID_FILL, COLOR(0, 128, 0));
-				setcolor(COLOR(0, 254, 0));
-				fillpoly(4, PlayerDots);
-			}
-			PlayerBullets.DrawBullets();
-			EnemyBullets.DrawBullets();
-			LaserBullets.DrawBullets();
-
-			DrawGui(Player.GetHealth(), PlayingTime, Player.GetEnergy(), EnergyGraph, Kills, k, Lose);
+			RenderSnapshot & Frame = Renderer.GetBack();
+			Frame.Shiftx = 25.0*Player.GetCenter(Ship::Center_x)/ScreenWidth;
+			Frame.Shifty = 25.0*Player.GetCenter(Ship::Center_y)/ScreenHeight;
+			Frame.SkyAngle = Stars.Turn();
+			Frame.BullsCount = Bulls.GetLooks(Frame.Bulls);
+			Frame.TurretsCount = Turrets.GetLooks(Frame.Turrets);
+			Frame.LasersCount = Lasers.GetLooks(Frame.Lasers);
+			Frame.PlayerShown = Player.GetDots(Frame.PlayerDots);
+			PlayerBullets.GetLooks(Frame.PlayerBullets);
+			EnemyBullets.GetLooks(Frame.EnemyBullets);
+			LaserBullets.GetLooks(Frame.LaserBullets);
+			TrackGui(Frame.Gui, Player.GetHealth(), PlayingTime, Player.GetEnergy(), EnergyGraph, Kills, k, Lose);
+			Effects.CopyTo(Frame.Effects);
+			Player.GetCenter(Frame.PlayerCenter);
+			Frame.PlayerAngle = Player.GetAngle();
 
 			if(Lose)
 			{
 				if(LoseDelay)
 				{
+					Effects.Update();
+
 					Bulls.ProcessEnemys<double, double, bool, Ship & >(Player.GetCenter(Ship::Center_x), Player.GetCenter(Ship::Center_y), Player.IsAlive(), Player);
 					Bulls.CheckForHits(PlayerBullets);
-					Kills += Bulls.CheckForDead();
+					Kills += Bulls.CheckForDead(Effects);
 
 					Turrets.ProcessEnemys<double, double, bool, BulletsArray & >(Player.GetCenter(Ship::Center_x), Player.GetCenter(Ship::Center_y), Player.IsAlive(), EnemyBullets);
 					Turrets.CheckForHits(PlayerBullets);
-					Kills += Turrets.CheckForDead();
+					Kills += Turrets.CheckForDead(Effects);
 
 					Lasers.ProcessEnemys<double, double, bool, BulletsArray & >(Player.GetCenter(Ship::Center_x), Player.GetCenter(Ship::Center_y), Player.IsAlive(), LaserBullets);
 					Lasers.CheckForHits(PlayerBullets);
-					Kills += Lasers.CheckForDead();
+					Kills += Lasers.CheckForDead(Effects);
+					PlayerBullets.RemoveHits(Effects);
 
-					PlayerBullets.MoveBullets();
+					BulletsArray::MoveBullets();
 					PlayerBullets.CheckForDeletion();
-					EnemyBullets.MoveBullets();
 					EnemyBullets.CheckForDeletion();
-					LaserBullets.MoveBullets();
 					LaserBullets.CheckForDeletion();
 
-					if(PlayerBlowUp < 15)
-					{
-						double xy[2];
-						Player.GetCenter(xy);
-						setcolor(COLOR(255, 64, 0));
-						setfillstyle(SOLID_FILL, COLOR(255, 128, 0));
-						fillellipse(xy[0], xy[1], PlayerBlowUp*3, PlayerBlowUp*3);
-						PlayerBlowUp++;
-					}
-
 					LoseDelay--;
-					swapbuffers();
+					Renderer.Publish();
 					delay(DelayTime);
 					continue;
 				}
 				else
 				{
+					Renderer.Wait();
+					Draw(Frame);
 					GameProccessed = loseProcess();
 					if(GameProccessed == GameRestarting)
 						break;
@@ -1198,6 +2195,8 @@ int main()
 
 			if(GameProccessed == GamePaused)
 			{
+				Renderer.Wait();
+				Draw(Frame);
 				GameProccessed = pauseProcess();
 				if(GameProccessed == GameRestarting)
 					break;
@@ -1212,6 +2211,8 @@ int main()
 				case 27:
 					ClearInput();
 					Shooting = false;
+					Renderer.Wait();
+					Draw(Frame);
 					GameProccessed = pauseProcess();
 					break;
 
@@ -1297,18 +2298,20 @@ int main()
 			if(Shooting)
 				Player.Shoot(PlayerBullets);
 
+			Effects.Update();
+
 			Bulls.ProcessEnemys<double, double, bool, Ship &>(Player.GetCenter(Ship::Center_x), Player.GetCenter(Ship::Center_y), Player.IsAlive(), Player);
-			Kills += Bulls.CheckForDead();
+			Kills += Bulls.CheckForDead(Effects);
 			if(SpawnChance(5.0, 5.0, PlayingTime, Bulls.GetEnemysCount()))
 				Bulls.SpawnEnemy();
 
 			Turrets.ProcessEnemys<double, double, bool, BulletsArray &>(Player.GetCenter(Ship::Center_x), Player.GetCenter(Ship::Center_y), Player.IsAlive(), EnemyBullets);
-			Kills += Turrets.CheckForDead();
+			Kills += Turrets.CheckForDead(Effects);
 			if(SpawnChance(2.5, 2.5, PlayingTime, Turrets.GetEnemysCount() + 1))
 				Turrets.SpawnEnemy();
 
 			Lasers.ProcessEnemys<double, double, bool, BulletsArray &>(Player.GetCenter(Ship::Center_x), Player.GetCenter(Ship::Center_y), Player.IsAlive(), LaserBullets);
-			Kills += Lasers.CheckForDead();
+			Kills += Lasers.CheckForDead(Effects);
 			if(SpawnChance(1.0, 1.0, PlayingTime, Lasers.GetEnemysCount() + 1))
 				Lasers.SpawnEnemy();
 
@@ -1316,6 +2319,7 @@ int main()
 			if(!Player.IsAlive())
 			{
 				Lose = true;
+				Effects.Blast(Player.GetCenter(Ship::Center_x), Player.GetCenter(Ship::Center_y), Particles::Over, Particles::BlowUpLife, COLOR(255, 64, 0), COLOR(255, 128, 0), 0);
 				continue;
 			}
 
@@ -1323,11 +2327,9 @@ int main()
 			Player.HealthRegenerate();
 			Player.RefreshCoolDown();
 
-			PlayerBullets.MoveBullets();
+			BulletsArray::MoveBullets();
 			PlayerBullets.CheckForDeletion();
-			EnemyBullets.MoveBullets();
 			EnemyBullets.CheckForDeletion();
-			LaserBullets.MoveBullets();
 			LaserBullets.CheckForDeletion();
 
 			Bulls.CheckForHits(PlayerBullets);
@@ -1335,6 +2337,9 @@ int main()
 			Lasers.CheckForHits(PlayerBullets);
 			Player.CheckForHits(EnemyBullets);
 			Player.CheckForHits(LaserBullets, 50.0);
+			PlayerBullets.RemoveHits(Effects);
+			EnemyBullets.RemoveHits(Effects);
+			LaserBullets.RemoveHits(Effects);
 
 			if(iddqd == 5)
 			{
@@ -1348,9 +2353,14 @@ int main()
 			}
 			PlayingTime += TimeCounter;
 
-			swapbuffers();
+			// The pause menu was drawn here on top of the frame, see above
+			if(GameProccessed == GameInProcess)
+				Renderer.Publish();
+			else
+				swapbuffers();
 			delay(DelayTime);
 		}
+		Renderer.Wait();
 		ClearInput();
 	}
 	#ifdef IncludeCosTable
@@ -1360,6 +2370,19 @@ int main()
 	return 0;
 }
 
+// A line of menu text centered on Centerx, with the box the mouse hits it in.
+// It is measured once, in the text style it is drawn with, instead of every frame.
+struct MenuText
+{
+	char * Text;
+	int Left, Top, Right, Bottom;
+
+	MenuText(char * Text_, int Centerx, int Top_): Text(Text_), Left(Centerx - textwidth(Text_)/2), Top(Top_),
+												   Right(Left + textwidth(Text_)), Bottom(Top + textheight(Text_)) {}
+	bool Contains(int x, int y) const {return Left < x && Top < y && Right > x && Bottom > y;}
+	void Draw() const {outtextxy(Left, Top, Text);}
+};
+
 static bool menuProcess(int EndGameState)
 {
 	if(EndGameState == GameRestarting)
@@ -1368,20 +2391,26 @@ static bool menuProcess(int EndGameState)
 	const int StarsCount = 750;
 	MovableStar Stars[StarsCount];
 	int x, y;
+	settextstyle(DEFAULT_FONT, HORIZ_DIR, 10);
+	static const MenuText Title(const_cast<char *>("SPACE WAR"), ScreenHalfWidth, ScreenHeight/5);
+	settextstyle(DEFAULT_FONT, HORIZ_DIR, 4);
+	static const MenuText Play(sPlay, ScreenHalfWidth, ScreenHeight*2/5);
+	static const MenuText Quit(sQuit, ScreenHalfWidth, ScreenHalfHeight);
 	while(1)
 	{
+		Quality.Begin();
 		cleardevice();
 
 		setcolor(COLOR(0, 255, 0));
 		settextstyle(DEFAULT_FONT, HORIZ_DIR, 10);
-		outtextxy((ScreenWidth - textwidth(const_cast<char *>("SPACE WAR")))/2, ScreenHeight/5, const_cast<char *>("SPACE WAR"));
+		Title.Draw();
 
 		settextstyle(DEFAULT_FONT, HORIZ_DIR, 4);
 
 		if(ismouseclick(WM_MOUSEMOVE))
 			getmouseclick(WM_MOUSEMOVE, x, y);
 
-		if(!QuitClicked && (ScreenWidth - textwidth(sPlay))/2 < x && ScreenHeight*2/5 < y && (ScreenWidth + textwidth(sPlay))/2 > x && ScreenHeight*2/5 + textheight(sPlay) > y)
+		if(!QuitClicked && Play.Contains(x, y))
 		{
 			setcolor(COLOR(0, 255, 0));
 			if(ismouseclick(WM_LBUTTONDOWN))
@@ -1401,9 +2430,9 @@ static bool menuProcess(int EndGameState)
 			setcolor(COLOR(255, 0, 0));
 		else
 			PlayClicked = false;
-		outtextxy((ScreenWidth - textwidth(sPlay))/2, ScreenHeight*2/5, sPlay);
+		Play.Draw();
 
-		if(!PlayClicked && (ScreenWidth - textwidth(sQuit))/2 < x && ScreenHalfHeight < y && (ScreenWidth + textwidth(sQuit))/2 > x && ScreenHalfHeight + textheight(sQuit) > y)
+		if(!PlayClicked && Quit.Contains(x, y))
 		{
 			setcolor(COLOR(0, 255, 0));
 			if(ismouseclick(WM_LBUTTONDOWN))
@@ -1423,12 +2452,12 @@ static bool menuProcess(int EndGameState)
 			setcolor(COLOR(255, 0, 0));
 		else
 			QuitClicked = false;
-		outtextxy((ScreenWidth - textwidth(sQuit))/2, ScreenHalfHeight, sQuit);
+		Quit.Draw();
 
 		clearmouseclick(WM_LBUTTONUP);
 
 		setcolor(WHITE);
-		for(int i = 0; i < StarsCount; i++)
+		for(int i = 0; i < StarsCount*Quality.Get().StarsShare/100; i++)
 			if(Stars[i].inScreen(ScreenWidth, ScreenHeight))
 			{
 				moveto(Stars[i].x, Stars[i].y);
@@ -1440,6 +2469,7 @@ static bool menuProcess(int EndGameState)
 				Stars[i] = MovableStar();
 
 		swapbuffers();
+		Quality.End();
 		delay(DelayTime);
 	}
 }
@@ -1455,13 +2485,17 @@ static int pauseProcess()
 	floodfill(ScreenHalfWidth, ScreenHalfHeight, COLOR(0, 255, 0));
 
 	settextstyle(DEFAULT_FONT, HORIZ_DIR, 4);
+	static const MenuText Heading(sGamePaused, ScreenHalfWidth, ScreenHeight/3 - textheight(sGamePaused)/2);
+	static const MenuText Resume(sResume, ScreenHalfWidth, SHHx075);
+	static const MenuText Restart(sRestart, ScreenHalfWidth, SHHx075 + ScreenHeight/10);
+	static const MenuText Exit(sExit, ScreenHalfWidth, SHHx075 + ScreenHeight/5);
 
-	outtextxy(ScreenHalfWidth - textwidth(sGamePaused)/2, ScreenHeight/3 - textheight(sGamePaused)/2, sGamePaused);
+	Heading.Draw();
 
 	if(ismouseclick(WM_MOUSEMOVE))
 		getmouseclick(WM_MOUSEMOVE, x, y);
 
-	if(!ExitClicked &&  !RestartClicked && (ScreenHalfWidth - textwidth(sResume)/2) < x && SHHx075 < y && (ScreenHalfWidth + textwidth(sResume)/2) > x && SHHx075 + textheight(sResume) > y)
+	if(!ExitClicked && !RestartClicked && Resume.Contains(x, y))
 	{
 		setcolor(COLOR(0, 255, 0));
 		if(ismouseclick(WM_LBUTTONDOWN))
@@ -1482,9 +2516,9 @@ static int pauseProcess()
 		setcolor(COLOR(255, 0, 0));
 	else
 		ResumeClicked = false;
-	outtextxy(ScreenHalfWidth - textwidth(sResume)/2, SHHx075, sResume);
+	Resume.Draw();
 
-	if(!ResumeClicked && !ExitClicked && (ScreenHalfWidth - textwidth(sRestart)/2) < x && (SHHx075 + ScreenHeight/10) < y && (ScreenHalfWidth + textwidth(sRestart)/2) > x && (SHHx075 + ScreenHeight/10) + textheight(sRestart) > y)
+	if(!ResumeClicked && !ExitClicked && Restart.Contains(x, y))
 	{
 		setcolor(COLOR(0, 255, 0));
 		if(ismouseclick(WM_LBUTTONDOWN))
@@ -1505,9 +2539,9 @@ static int pauseProcess()
 		setcolor(COLOR(255, 0, 0));
 	else
 		RestartClicked = false;
-	outtextxy(ScreenHalfWidth - textwidth(sRestart)/2, SHHx075 + ScreenHeight/10, sRestart);
+	Restart.Draw();
 
-	if(!ResumeClicked && !RestartClicked && (ScreenHalfWidth - textwidth(sExit)/2) < x && (SHHx075 + ScreenHeight/5) < y && (ScreenHalfWidth + textwidth(sExit)/2) > x &&  (SHHx075 + ScreenHeight/5) + textheight(sExit) > y)
+	if(!ResumeClicked && !RestartClicked && Exit.Contains(x, y))
 	{
 		setcolor(COLOR(0, 255, 0));
 		if(ismouseclick(WM_LBUTTONDOWN))
@@ -1528,7 +2562,7 @@ static int pauseProcess()
 		setcolor(COLOR(255, 0, 0));
 	else
 		ExitClicked = false;
-	outtextxy(ScreenHalfWidth - textwidth(sExit)/2, SHHx075 + ScreenHeight/5, sExit);
+	Exit.Draw();
 
 	clearmouseclick(WM_LBUTTONUP);
 
@@ -1549,13 +2583,16 @@ static int loseProcess()
 	floodfill(ScreenHalfWidth, ScreenHalfHeight, COLOR(254, 0, 0));
 
 	settextstyle(DEFAULT_FONT, HORIZ_DIR, 4);
+	static const MenuText Heading(sYouLose, ScreenHalfWidth, ScreenHalfHeight*3/4 - textheight(sYouLose)/2);
+	static const MenuText Restart(sRestart, ScreenHalfWidth, ScreenHalfHeight*7/8 - textheight(sRestart)/2);
+	static const MenuText Exit(sExit, ScreenHalfWidth, ScreenHalfHeight*9/8 - textheight(sExit)/2);
 
-	outtextxy(ScreenHalfWidth - textwidth(sYouLose)/2, ScreenHalfHeight*3/4 - textheight(sYouLose)/2, sYouLose);
+	Heading.Draw();
 
 	if(ismouseclick(WM_MOUSEMOVE))
 		getmouseclick(WM_MOUSEMOVE, x, y);
 
-	if(!ExitClicked && (ScreenHalfWidth - textwidth(sRestart)/2) < x && (ScreenHalfHeight*7/8 - textheight(sRestart)/2) < y && (ScreenHalfWidth + textwidth(sRestart)/2) > x && ScreenHalfHeight*7/8 + textheight(sRestart)/2 > y)
+	if(!ExitClicked && Restart.Contains(x, y))
 	{
 		setcolor(COLOR(255, 0, 0));
 		if(ismouseclick(WM_LBUTTONDOWN))
@@ -1576,9 +2613,9 @@ static int loseProcess()
 		setcolor(COLOR(0, 255, 0));
 	else
 		RestartClicked = false;
-	outtextxy(ScreenHalfWidth - textwidth(sRestart)/2, ScreenHalfHeight*7/8 - textheight(sRestart)/2, sRestart);
+	Restart.Draw();
 
-	if(!RestartClicked && (ScreenHalfWidth - textwidth(sExit)/2) < x && (ScreenHalfHeight*9/8 - textheight(sExit)/2) < y && (ScreenHalfWidth + textwidth(sExit)/2) > x && ScreenHalfHeight*9/8 + textheight(sExit) > y)
+	if(!RestartClicked && Exit.Contains(x, y))
 	{
 		setcolor(COLOR(255, 0, 0));
 		if(ismouseclick(WM_LBUTTONDOWN))
@@ -1599,21 +2636,95 @@ static int loseProcess()
 		setcolor(COLOR(0, 255, 0));
 	else
 		ExitClicked = false;
-	outtextxy(ScreenHalfWidth - textwidth(sExit)/2, ScreenHalfHeight*9/8 - textheight(sExit)/2, sExit);
+	Exit.Draw();
 
 	clearmouseclick(WM_LBUTTONUP);
 
 	return LoseProcessed;
 }
 
-static void DrawGui(double Health, double Time, int Energy, double EnergyGraph[30], unsigned int Kills, double k, bool LoseBulb)
+// The HUD frame never changes, so it is drawn once on a spare page and kept as
+// images of the three parts of the screen it covers. Each part has an AND mask,
+// the frame drawn on white, and an OR image, the frame drawn on black. The frame
+// only uses colors c for which (Screen & c) | c == c, so putting both paints the
+// frame exactly as drawing it would, and leaves the game showing elsewhere.
+class GuiChrome
 {
-	static bool GodModeUsed, InfEnergyUsed;
-	static counter<2> EnergyGraphCounter;
+private:
 
-	if(Kills == 0)
-		GodModeUsed = InfEnergyUsed = false;
+	static const int PartsCount = 3;
+	static const int Parts[PartsCount][4];
+	void * Masks[PartsCount];
+	void * Images[PartsCount];
+
+	static void DrawFrame();
+	void Capture(void * Buffers[PartsCount], int Background);
+
+public:
+
+	GuiChrome();
+	GuiChrome(GuiChrome &) = delete;
+	GuiChrome & operator=(GuiChrome &) = delete;
+	void Draw();
+	~GuiChrome();
+};
+
+const int GuiChrome::Parts[GuiChrome::PartsCount][4] = {{0, 0, 225, 50},
+														 {ScreenWidth - 225, 0, ScreenWidth - 1, 50},
+														 {0, ScreenHeight - 75, ScreenWidth - 1, ScreenHeight - 1}};
+
+// It is drawn on a spare page, and whatever it sets is put back, so the
+// drawing that comes next doesn't notice it.
+GuiChrome::GuiChrome()
+{
+	const int ActivePage = getactivepage(), Background = getbkcolor(), Color = getcolor(), x = getx(), y = gety();
+	linesettingstype Line;
+	fillsettingstype Fill;
+	getlinesettings(&Line);
+	getfillsettings(&Fill);
+	setactivepage(2);
+	Capture(Masks, WHITE);
+	Capture(Images, BLACK);
+	setactivepage(ActivePage);
+	setbkcolor(Background);
+	setcolor(Color);
+	setlinestyle(Line.linestyle, Line.upattern, Line.thickness);
+	setfillstyle(Fill.pattern, Fill.color);
+	moveto(x, y);
+}
+
+// Built by main before the first frame, like the hulls, so that the first
+// game frame doesn't stop to draw it on the render thread.
+static GuiChrome & Chrome()
+{
+	static GuiChrome Built;
+	return Built;
+}
+
+GuiChrome::~GuiChrome()
+{
+	for(int i = 0; i < PartsCount; i++)
+	{
+		delete [] static_cast<char *>(Masks[i]);
+		delete [] static_cast<char *>(Images[i]);
+	}
+}
 
+void GuiChrome::Capture(void * Buffers[PartsCount], int Background)
+{
+	setbkcolor(Background);
+	cleardevice();
+	DrawFrame();
+	for(int i = 0; i < PartsCount; i++)
+	{
+		Buffers[i] = new char[imagesize(Parts[i][0], Parts[i][1], Parts[i][2], Parts[i][3])];
+		getimage(Parts[i][0], Parts[i][1], Parts[i][2], Parts[i][3], Buffers[i]);
+	}
+}
+
+void GuiChrome::DrawFrame()
+{
+	setlinestyle(SOLID_LINE, 0, 1);
 	setcolor(COLOR(0, 255, 0));
 	setfillstyle(SOLID_FILL, BLACK);
 
@@ -1650,11 +2761,147 @@ static void DrawGui(double Health, double Time, int Energy, double EnergyGraph[3
 
 	setfillstyle(SOLID_FILL, BLACK);
 	bar(150, ScreenHeight - 40, ScreenWidth - 150, ScreenHeight - 10);
+
+	setcolor(COLOR(0, 128, 0));
+	line(ScreenWidth - 67, ScreenHeight - 37, ScreenWidth - 8, ScreenHeight - 37);
+	line(ScreenWidth - 37, ScreenHeight - 67, ScreenWidth - 37, ScreenHeight - 8);
+
+	setlinestyle(SOLID_LINE, 0, 5);
+	setcolor(BLACK);
+	arc(40, ScreenHeight - 37, 0, 360, 25);
+	setlinestyle(SOLID_LINE, 0, 1);
+}
+
+void GuiChrome::Draw()
+{
+	for(int i = 0; i < PartsCount; i++)
+	{
+		putimage(Parts[i][0], Parts[i][1], Masks[i], AND_PUT);
+		putimage(Parts[i][0], Parts[i][1], Images[i], OR_PUT);
+	}
+}
+
+// Copies of the readouts of the HUD, for the frames that don't draw them
+// again. Each part lies inside the opaque chrome, so putting it back whole
+// leaves nothing of the frame under it.
+class GuiReadouts
+{
+private:
+
+	static const int PartsCount = 7;
+	static const int Parts[PartsCount][4];
+	void * Images[PartsCount];
+	bool Captured;
+
+public:
+
+	GuiReadouts();
+	GuiReadouts(GuiReadouts &) = delete;
+	GuiReadouts & operator=(GuiReadouts &) = delete;
+	void Capture();
+	bool Restore();
+	void Drop(){Captured = false;}
+	~GuiReadouts();
+};
+
+// The time, the kills, the health bar, the energy ring, the energy graph, the
+// heartbeat graph and the cheat bulbs
+const int GuiReadouts::Parts[GuiReadouts::PartsCount][4] = {{0, 0, 175, 48},
+															 {ScreenWidth - 176, 0, ScreenWidth - 1, 48},
+															 {150, ScreenHeight - 40, ScreenWidth - 150, ScreenHeight - 10},
+															 {12, ScreenHeight - 65, 68, ScreenHeight - 9},
+															 {71, ScreenHeight - 29, 99, ScreenHeight - 11},
+															 {ScreenWidth - 68, ScreenHeight - 68, ScreenWidth - 7, ScreenHeight - 7},
+															 {ScreenWidth - 93, ScreenHeight - 23, ScreenWidth - 77, ScreenHeight - 7}};
+
+GuiReadouts::GuiReadouts(): Captured(false)
+{
+	for(int i = 0; i < PartsCount; i++)
+		Images[i] = new char[imagesize(Parts[i][0], Parts[i][1], Parts[i][2], Parts[i][3])];
+}
+
+GuiReadouts::~GuiReadouts()
+{
+	for(int i = 0; i < PartsCount; i++)
+		delete [] static_cast<char *>(Images[i]);
+}
+
+void GuiReadouts::Capture()
+{
+	for(int i = 0; i < PartsCount; i++)
+		getimage(Parts[i][0], Parts[i][1], Parts[i][2], Parts[i][3], Images[i]);
+	Captured = true;
+}
+
+bool GuiReadouts::Restore()
+{
+	if(!Captured)
+		return false;
+	for(int i = 0; i < PartsCount; i++)
+		putimage(Parts[i][0], Parts[i][1], Images[i], COPY_PUT);
+	return true;
+}
+
+// The energy graph moves on every second tick, and the heartbeat by the 61
+// pixels of its width. A cheat bulb shows whether the cheat was used since
+// the last kill; the one of the infinite energy lights up a tick late, as it
+// always did.
+static void TrackGui(GuiLook & Gui, double Health, double Time, int Energy, double EnergyGraph[30], unsigned int Kills, double k, bool LoseBulb)
+{
+	static bool GodModeUsed, InfEnergyUsed;
+	static counter<2> EnergyGraphCounter;
+	static double GraphPhase = 0.0;
+
+	if(Kills == 0)
+		GodModeUsed = InfEnergyUsed = false;
+	if(Health < 0.0)
+		GodModeUsed = true;
+
+	Gui.Health = Health;
+	Gui.GraphPhase = GraphPhase;
+	Gui.Time = Time;
+	Gui.Energy = Energy;
+	memcpy(Gui.EnergyGraph, EnergyGraph, sizeof(Gui.EnergyGraph));
+	Gui.Kills = Kills;
+	Gui.k = k;
+	Gui.LoseBulb = LoseBulb;
+	Gui.GodModeUsed = GodModeUsed;
+	Gui.InfEnergyUsed = InfEnergyUsed;
+
+	if(Energy < 0.0)
+	{
+		Energy = 100.0;
+		InfEnergyUsed = true;
+	}
+	GraphPhase += 61*0.001;
+	EnergyGraphCounter++;
+	if(EnergyGraphCounter)
+	{
+		for(int i = 0; i < 29; i++)
+			EnergyGraph[i] = EnergyGraph[i+1];
+		EnergyGraph[28] = Energy;
+	}
+}
+
+// The readouts are only drawn once in GuiInterval frames of the quality level,
+// and put back from their copies in between.
+static void DrawGui(DrawBatch & Batch, const GuiLook & Gui)
+{
+	double Health = Gui.Health;
+	int Energy = Gui.Energy;
+	const QualityGovernor::Level & Look = Quality.Get();
+
+	static GuiReadouts Readouts;
+	static int Frames = 0;
+	Chrome().Draw();
+	if(++Frames < Look.GuiInterval && Readouts.Restore())
+		return;
+	Frames = 0;
+
 	if(Health < 0.0)
 	{
 		setfillstyle(SOLID_FILL, COLOR(160, 192, 224));
 		Health = 100.0;
-		GodModeUsed = true;
 	}
 	else
 		setfillstyle(SOLID_FILL, COLOR(255 * min((100.0 - Health)/50.0, 1.0), 255 * min(Health/50.0, 1.0), 0));
@@ -1663,40 +2910,29 @@ static void DrawGui(double Health, double Time, int Energy, double EnergyGraph[3
 	setcolor(COLOR(0, 255, 0));
 	settextstyle(SANS_SERIF_FONT, HORIZ_DIR, 5);
 	char buf[15];
-	ConvertTime(Time, buf, 2);
+	ConvertTime(Gui.Time, buf, 2);
 	outtextxy(175 - textwidth(buf), 25 - textheight(buf)/2, buf);
 
-	numberToString(Kills, buf);
+	numberToString(Gui.Kills, buf);
 	outtextxy(ScreenWidth - 175, 25 - textheight(buf)/2, buf);
 
-	setcolor(COLOR(0, 128, 0));
-	line(ScreenWidth - 67, ScreenHeight - 37, ScreenWidth - 8, ScreenHeight - 37);
-	line(ScreenWidth - 37, ScreenHeight - 67, ScreenWidth - 37, ScreenHeight - 8);
 	setcolor(COLOR(0, 255, 0));
 	float s;
 	int i;
-	static double Graph = 0.0;
+	double Graph = Gui.GraphPhase;
 	moveto(ScreenWidth - 67, ScreenHeight - 37 + fsin(Graph - 1.0)*(Health/5.0)/2.75);
-	for(i = ScreenWidth - 68, s = 0.0; i <= ScreenWidth - 8; i++, s += k*pi, Graph += 0.001)
-		lineto(i, ScreenHeight - 37 + fsin(Graph + s - fcos(s))*(Health/5.0)/(fcos(s/k) + 1.75));
-	setfillstyle(SOLID_FILL, GodModeUsed? COLOR(255, 0, 0): COLOR(0, 255, 0));
-	setcolor(GodModeUsed? COLOR(128, 0, 0): COLOR(0, 128, 0));
-	fillellipse(ScreenWidth - 80, ScreenHeight - 10, 3, 3);
-	setfillstyle(SOLID_FILL, InfEnergyUsed? COLOR(255, 0, 0): COLOR(0, 255, 0));
-	setcolor(InfEnergyUsed? COLOR(128, 0, 0): COLOR(0, 128, 0));
-	fillellipse(ScreenWidth - 90, ScreenHeight - 10, 3, 3);
-	setfillstyle(SOLID_FILL, LoseBulb? COLOR(255, 0, 0): COLOR(0, 255, 0));
-	setcolor(LoseBulb? COLOR(128, 0, 0): COLOR(0, 128, 0));
-	fillellipse(ScreenWidth - 80, ScreenHeight - 20, 3, 3);
+	for(i = ScreenWidth - 68, s = 0.0; i <= ScreenWidth - 8; i += Look.GraphStep, s += Look.GraphStep*Gui.k*pi, Graph += Look.GraphStep*0.001)
+		lineto(i, ScreenHeight - 37 + fsin(Graph + s - fcos(s))*(Health/5.0)/(fcos(s/Gui.k) + 1.75));
+	Batch.FillEllipse(ScreenWidth - 80, ScreenHeight - 10, 3, 3, Gui.GodModeUsed? COLOR(128, 0, 0): COLOR(0, 128, 0), Gui.GodModeUsed? COLOR(255, 0, 0): COLOR(0, 255, 0));
+	Batch.FillEllipse(ScreenWidth - 90, ScreenHeight - 10, 3, 3, Gui.InfEnergyUsed? COLOR(128, 0, 0): COLOR(0, 128, 0), Gui.InfEnergyUsed? COLOR(255, 0, 0): COLOR(0, 255, 0));
+	Batch.FillEllipse(ScreenWidth - 80, ScreenHeight - 20, 3, 3, Gui.LoseBulb? COLOR(128, 0, 0): COLOR(0, 128, 0), Gui.LoseBulb? COLOR(255, 0, 0): COLOR(0, 255, 0));
+	Batch.Flush();
 
 	setlinestyle(SOLID_LINE, 0, 5);
-	setcolor(BLACK);
-	arc(40, ScreenHeight - 37, 0, 360, 25);
 	if(Energy < 0.0)
 	{
 		setcolor(COLOR(160, 192, 224));
 		Energy = 100.0;
-		InfEnergyUsed = true;
 	}
 	else
 		setcolor(COLOR(255 * min((100.0 - Energy)/50.0, 1.0), 255 * min(Energy/50.0, 1.0), 0));
@@ -1710,10 +2946,9 @@ static void DrawGui(double Health, double Time, int Energy, double EnergyGraph[3
 	setlinestyle(SOLID_LINE, 0, 1);
 	for(i = 71; i < 100; i++)
 	{
-		setcolor(COLOR(192 * min((100.0 - EnergyGraph[i - 71])/50.0, 1.0), 192 * min(EnergyGraph[i - 71]/50.0, 1.0), 0));
-		line(i, ScreenHeight - 11, i, ScreenHeight - 11 - 18 * EnergyGraph[i - 71]/100);
+		setcolor(COLOR(192 * min((100.0 - Gui.EnergyGraph[i - 71])/50.0, 1.0), 192 * min(Gui.EnergyGraph[i - 71]/50.0, 1.0), 0));
+		line(i, ScreenHeight - 11, i, ScreenHeight - 11 - 18 * Gui.EnergyGraph[i - 71]/100);
 	}
-	EnergyGraphCounter++;
 	setcolor(COLOR(0, 128, 0));
 	line(71, ScreenHeight - 25, 99, ScreenHeight - 25);
 	line(71, ScreenHeight - 20, 99, ScreenHeight - 20);
@@ -1722,12 +2957,11 @@ static void DrawGui(double Health, double Time, int Energy, double EnergyGraph[3
 	line(82, ScreenHeight - 29, 82, ScreenHeight - 11);
 	line(88, ScreenHeight - 29, 88, ScreenHeight - 11);
 	line(94, ScreenHeight - 29, 94, ScreenHeight - 11);
-	if(EnergyGraphCounter)
-	{
-		for(i = 0; i < 29; i++)
-			EnergyGraph[i] = EnergyGraph[i+1];
-		EnergyGraph[28] = Energy;
-	}
+
+	if(Look.GuiInterval > 1)
+		Readouts.Capture();
+	else
+		Readouts.Drop();
 }
 
 static void ClearInput()